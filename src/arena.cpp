@@ -0,0 +1,50 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+
+namespace utils {
+
+void Arena::AddSlab(size_t min_size) {
+    const size_t size = std::max(min_size, slab_size_);
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    //only a hint, kernel may have transparent huge pages disabled
+    if (huge_pages_)
+        madvise(data, size, MADV_HUGEPAGE);
+#endif
+    Slab slab{(char*) data, size};
+    slabs_.insert(std::upper_bound(slabs_.begin(), slabs_.end(), slab,
+                                   [](const Slab &a, const Slab &b) { return a.data < b.data; }),
+                  slab);
+    //the rest of the current slab is abandoned
+    pos_ = slab.data;
+    end_ = slab.data + size;
+}
+
+Arena::~Arena() {
+    for (const Slab &s : slabs_)
+        munmap(s.data, s.size);
+}
+
+bool Arena::contains(const void *p) const {
+    const char *c = (const char*) p;
+    auto it = std::upper_bound(slabs_.begin(), slabs_.end(), c,
+                               [](const char *c, const Slab &s) { return c < s.data; });
+    if (it == slabs_.begin())
+        return false;
+    --it;
+    return c < it->data + it->size;
+}
+
+size_t Arena::reserved() const {
+    size_t answer = 0;
+    for (const Slab &s : slabs_)
+        answer += s.size;
+    return answer;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace utils {
+
+//Bump allocator handing out memory from large anonymous mappings (slabs),
+//which are only released all together when the arena is destroyed.
+//Saves per-allocation overhead and heap fragmentation for millions of small immutable strings.
+//Slabs can be madvise-d to be backed by transparent huge pages (off by default,
+//partially filled 2 MB pages raise resident memory).
+class Arena {
+public:
+    static const size_t DEFAULT_SLAB_SIZE = 64 << 20;
+
+private:
+    struct Slab {
+        char *data;
+        size_t size;
+    };
+
+    const size_t slab_size_;
+    const bool huge_pages_;
+    //sorted by address
+    std::vector<Slab> slabs_;
+    char *pos_ = nullptr;
+    char *end_ = nullptr;
+    size_t allocated_ = 0;
+
+    void AddSlab(size_t min_size);
+
+public:
+    explicit Arena(size_t slab_size = DEFAULT_SLAB_SIZE, bool huge_pages = false):
+        slab_size_(slab_size), huge_pages_(huge_pages) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena();
+
+    //Returns 8-byte aligned memory, allocations larger than the slab size get their own slab
+    void *Allocate(size_t size) {
+        size = (size + 7) & ~size_t(7);
+        if (size_t(end_ - pos_) < size)
+            AddSlab(size);
+        void *answer = pos_;
+        pos_ += size;
+        allocated_ += size;
+        return answer;
+    }
+
+    //Null-terminated copy of [s, s + len)
+    char *CopyString(const char *s, size_t len) {
+        char *answer = (char*) Allocate(len + 1);
+        memcpy(answer, s, len);
+        answer[len] = '\0';
+        return answer;
+    }
+
+    bool contains(const void *p) const;
+
+    //Bytes handed out
+    size_t allocated() const { return allocated_; }
+
+    //Bytes mapped (resident only once touched)
+    size_t reserved() const;
+};
+
+}
@@ -0,0 +1,696 @@
+#include "tooling.hpp"
+#include "tokenizer.hpp"
+#include "csr_graph.hpp"
+#include "overlay.hpp"
+#include "graph_builder.hpp"
+#include "gfa-priv.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <map>
+#include <deque>
+#include <malloc.h>
+#include <unistd.h>
+
+//Microbenchmarks of performance-critical parts on a user-provided graph
+
+namespace {
+
+struct cmd_cfg {
+    std::string mode;
+    std::string graph_in;
+    std::string coverage;
+    unsigned threads = 1;
+    unsigned repeats = 3;
+};
+
+//Best time (in seconds) over several runs
+double Measure(unsigned repeats, const std::function<void ()> &f) {
+    double best = -1.;
+    for (unsigned i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (best < 0. || elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+void Report(const std::string &name, size_t bytes, double seconds) {
+    std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << seconds << " s"
+              << std::setw(12) << std::setprecision(1) << double(bytes) / seconds / (1 << 20) << " MB/s"
+              << std::endl;
+}
+
+std::vector<utils::tokenizer::Level> AvailableLevels() {
+    using utils::tokenizer::Level;
+    std::vector<Level> levels;
+    for (Level l : {Level::SCALAR, Level::SSE42, Level::AVX2})
+        if (l <= utils::tokenizer::BestLevel())
+            levels.push_back(l);
+    return levels;
+}
+
+//Line/field splitting throughput and whole graph loading against gfa_read
+void BenchmarkTokenizer(const cmd_cfg &cfg) {
+    using namespace utils::tokenizer;
+    std::string content;
+    if (!utils::ReadFile(cfg.graph_in, content)) {
+        std::cerr << "Failed to read " << cfg.graph_in << std::endl;
+        exit(2);
+    }
+    const size_t size = content.size();
+    const Level best = BestLevel();
+
+    for (Level l : AvailableLevels()) {
+        SetLevel(l);
+        size_t field_cnt = 0;
+        double t = Measure(cfg.repeats, [&]() {
+            Token fields[7];
+            const char *b = content.data();
+            const char *e = b + size;
+            while (b < e) {
+                size_t cnt = 1;
+                if (b[0] == 'S' || b[0] == 'L')
+                    b = SplitLine(b, e, '\t', fields, b[0] == 'S' ? 4 : 7, cnt) + 1;
+                else
+                    b = FindChar(b, e, '\n') + 1;
+                field_cnt += cnt;
+            }
+        });
+        Report(std::string("split lines (") + LevelName(l) + ")", size, t);
+        DEBUG("Field cnt " << field_cnt);
+    }
+
+    Report("gfa_read", size, Measure(cfg.repeats, [&]() {
+        gfa_destroy(gfa_read(cfg.graph_in.c_str()));
+    }));
+
+    for (Level l : AvailableLevels()) {
+        SetLevel(l);
+        Report(std::string("loader, ") + std::to_string(cfg.threads) + " thread(s) (" + LevelName(l) + ")",
+               size, Measure(cfg.repeats, [&]() {
+            gfa_destroy(gfa::io::ReadParallel(cfg.graph_in, cfg.threads));
+        }));
+    }
+    SetLevel(best);
+}
+
+//Writing of the graph as plain and BGZF-compressed GFA
+void BenchmarkOutput(const cmd_cfg &cfg) {
+    gfa::Graph g;
+    g.open(cfg.graph_in, cfg.threads);
+    const std::string plain_fn = cfg.graph_in + ".bench.gfa";
+    const std::string compressed_fn = cfg.graph_in + ".bench.gfa.gz";
+
+    double t = Measure(cfg.repeats, [&]() { g.write(plain_fn); });
+    std::ifstream is(plain_fn, std::ios::binary | std::ios::ate);
+    const size_t size = is.tellg();
+    Report("plain output", size, t);
+
+    Report(std::string("compressed output, ") + std::to_string(cfg.threads) + " thread(s)", size,
+           Measure(cfg.repeats, [&]() { g.write(compressed_fn, false, true, cfg.threads); }));
+
+    std::remove(plain_fn.c_str());
+    std::remove(compressed_fn.c_str());
+}
+
+//Unpacking of all segment sequences from the packed store in both orientations
+void BenchmarkSequence(const cmd_cfg &cfg) {
+    using namespace utils::tokenizer;
+    gfa::Graph g;
+    g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::PACKED);
+    const Level best = BestLevel();
+
+    size_t total = 0;
+    for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s)
+        total += g.has_sequence(s) ? g.segment_length(s) : 0;
+    std::string buf;
+    buf.reserve(total);
+
+    for (Level l : AvailableLevels()) {
+        SetLevel(l);
+        for (gfa::Direction d : {gfa::Direction::FORWARD, gfa::Direction::REVERSE}) {
+            Report(std::string(d == gfa::Direction::FORWARD ? "unpack" : "unpack rev. complement")
+                   + " (" + LevelName(l) + ")", total, Measure(cfg.repeats, [&]() {
+                buf.clear();
+                for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s)
+                    g.AppendSequence(gfa::DirectedSegment(s, d), 0, buf);
+            }));
+        }
+    }
+    SetLevel(best);
+
+    //Soft-masked copy of the sequences: alternating upper and lower-case windows, every third one masked with N/n.
+    //Has to round-trip exactly and stay close to 2 bits per base
+    const size_t window = 1000;
+    std::vector<std::string> masked(g.segment_cnt());
+    for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s) {
+        std::string &seq = masked[s];
+        g.AppendSequence(gfa::DirectedSegment::Forward(s), 0, seq);
+        for (size_t i = 0; i < seq.size(); ++i) {
+            const size_t w = i / window;
+            if (w % 3 == 2)
+                seq[i] = 'N';
+            if (w % 2 == 1)
+                seq[i] = char(std::tolower(seq[i]));
+        }
+    }
+    gfa::PackedSequences packed;
+    for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s)
+        packed.Assign(s, packed.Pack(masked[s].data(), masked[s].size()), uint32_t(masked[s].size()));
+
+    size_t mismatch_cnt = 0;
+    std::string expected;
+    for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s) {
+        buf.clear();
+        packed.Unpack(s, false, 0, buf);
+        mismatch_cnt += (buf != masked[s]);
+        buf.clear();
+        packed.Unpack(s, true, 0, buf);
+        expected.clear();
+        gfa::AppendReverseComplement(masked[s].data(), masked[s].size(), 0, expected);
+        mismatch_cnt += (buf != expected);
+    }
+    std::cout << "Mixed case: " << packed.memory() << " bytes packed for " << total << " bases, "
+              << mismatch_cnt << " mismatching sequences" << std::endl;
+    if (mismatch_cnt > 0)
+        exit(3);
+
+    Report("unpack mixed case", total, Measure(cfg.repeats, [&]() {
+        buf.clear();
+        for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s)
+            packed.Unpack(s, false, 0, buf);
+    }));
+}
+
+//Coverage loading and the link scan of unbalanced_removal with name-keyed lookups against segment id indexing
+void BenchmarkCoverage(const cmd_cfg &cfg) {
+    if (cfg.coverage.empty()) {
+        std::cerr << "Provide --coverage file" << std::endl;
+        exit(2);
+    }
+    std::ifstream is(cfg.coverage, std::ios::binary | std::ios::ate);
+    const size_t size = is.tellg();
+
+    gfa::Graph g;
+    g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::SKIP);
+
+    utils::SegmentCoverageMap segment_cov;
+    Report("read coverage map", size, Measure(cfg.repeats, [&]() {
+        segment_cov = utils::ReadCoverage(cfg.coverage);
+    }));
+    Report(std::string("load coverage, ") + std::to_string(cfg.threads) + " thread(s)", size,
+           Measure(cfg.repeats, [&]() { g.LoadCoverage(cfg.coverage, cfg.threads); }));
+
+    //same access pattern as unbalanced_removal, returns the number of links it would remove
+    const double ratio = 0.3;
+    auto scan = [&](const std::function<double (gfa::DirectedSegment)> &cov_f) {
+        size_t cnt = 0;
+        for (gfa::DirectedSegment ds : g.directed_segments()) {
+            double max_onb_cov = 0.;
+            for (gfa::LinkInfo l : g.outgoing_links(ds))
+                max_onb_cov = std::max(max_onb_cov, cov_f(l.end));
+            const double baseline_cov = cov_f(ds);
+            for (gfa::LinkInfo l : g.outgoing_links(ds)) {
+                const double nb_cov = cov_f(l.end);
+                if (nb_cov / baseline_cov <= ratio - 1e-5 && nb_cov != max_onb_cov)
+                    ++cnt;
+            }
+        }
+        return cnt;
+    };
+
+    //in bytes of the links scanned twice
+    const size_t link_bytes = g.link_cnt() * sizeof(gfa_arc_t) * 2;
+    size_t map_cnt = 0, vec_cnt = 0;
+    Report("unbalanced scan (name lookup)", link_bytes, Measure(cfg.repeats, [&]() {
+        map_cnt = scan([&](gfa::DirectedSegment v) { return utils::get(segment_cov, std::string(g.segment_name(v))); });
+    }));
+    Report("unbalanced scan (segment id)", link_bytes, Measure(cfg.repeats, [&]() {
+        vec_cnt = scan([&](gfa::DirectedSegment v) { return g.coverage(v); });
+    }));
+    if (map_cnt != vec_cnt) {
+        std::cerr << "Results differ: " << map_cnt << " vs " << vec_cnt << std::endl;
+        exit(3);
+    }
+}
+
+//Full-graph traversals over Graph iterators against the CsrGraph snapshot
+void BenchmarkTraversal(const cmd_cfg &cfg) {
+    gfa::Graph g;
+    g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::SKIP);
+
+    //in bytes of the links scanned in both directions
+    const size_t link_bytes = g.link_cnt() * sizeof(gfa_arc_t) * 2;
+
+    std::unique_ptr<gfa::CsrGraph> csr;
+    Report("build CsrGraph", link_bytes, Measure(cfg.repeats, [&]() {
+        csr.reset();
+        csr = std::make_unique<gfa::CsrGraph>(g);
+    }));
+    std::cout << "CsrGraph memory: " << csr->memory() / (1 << 20) << " MB" << std::endl;
+
+    //outgoing and incoming links of every vertex, returns checksum
+    auto scan = [&](const auto &adj) {
+        uint64_t sum = 0;
+        for (gfa::DirectedSegment v : g.directed_segments()) {
+            for (gfa::LinkInfo l : adj.outgoing_links(v))
+                sum += l.end.AsInnerVertexT() + uint32_t(l.end_overlap);
+            for (gfa::LinkInfo l : adj.incoming_links(v))
+                sum += l.start.AsInnerVertexT() + uint32_t(l.start_overlap);
+        }
+        return sum;
+    };
+
+    //BFS ignoring link directions from every unvisited vertex, returns checksum of visiting order
+    auto bfs = [&](const auto &adj) {
+        uint64_t sum = 0, cnt = 0;
+        std::vector<bool> visited(2 * size_t(g.segment_cnt()), false);
+        std::deque<gfa::DirectedSegment> queue;
+        for (gfa::DirectedSegment s : g.directed_segments()) {
+            if (visited[s.AsInnerVertexT()])
+                continue;
+            visited[s.AsInnerVertexT()] = true;
+            queue.push_back(s);
+            while (!queue.empty()) {
+                auto v = queue.front();
+                queue.pop_front();
+                sum += v.AsInnerVertexT() * ++cnt;
+                for (gfa::LinkInfo l : adj.outgoing_links(v))
+                    if (!visited[l.end.AsInnerVertexT()]) {
+                        visited[l.end.AsInnerVertexT()] = true;
+                        queue.push_back(l.end);
+                    }
+                for (gfa::LinkInfo l : adj.incoming_links(v))
+                    if (!visited[l.start.AsInnerVertexT()]) {
+                        visited[l.start.AsInnerVertexT()] = true;
+                        queue.push_back(l.start);
+                    }
+            }
+        }
+        return sum;
+    };
+
+    uint64_t graph_sum = 0, csr_sum = 0;
+    Report("link scan (Graph)", link_bytes, Measure(cfg.repeats, [&]() { graph_sum = scan(g); }));
+    Report("link scan (CsrGraph)", link_bytes, Measure(cfg.repeats, [&]() { csr_sum = scan(*csr); }));
+    if (graph_sum != csr_sum) {
+        std::cerr << "Link scan results differ" << std::endl;
+        exit(3);
+    }
+    Report("bfs (Graph)", link_bytes, Measure(cfg.repeats, [&]() { graph_sum = bfs(g); }));
+    Report("bfs (CsrGraph)", link_bytes, Measure(cfg.repeats, [&]() { csr_sum = bfs(*csr); }));
+    if (graph_sum != csr_sum) {
+        std::cerr << "BFS results differ" << std::endl;
+        exit(3);
+    }
+}
+
+//Traversals in segment id order after renumbering the graph with each of the locality orders
+void BenchmarkLocality(const cmd_cfg &cfg) {
+    //order-independent checksums, so that the results can be compared between the orders
+    auto scan = [](const auto &adj, uint32_t n_vtx) {
+        uint64_t sum = 0;
+        for (uint32_t inner_v = 0; inner_v < n_vtx; ++inner_v) {
+            auto v = gfa::DirectedSegment::FromInnerVertexT(inner_v);
+            for (gfa::LinkInfo l : adj.outgoing_links(v))
+                sum += uint32_t(l.end_overlap) + 1;
+            for (gfa::LinkInfo l : adj.incoming_links(v))
+                sum += uint32_t(l.start_overlap) + 1;
+        }
+        return sum;
+    };
+
+    auto bfs = [](const auto &adj, uint32_t n_vtx) {
+        uint64_t sum = 0;
+        std::vector<bool> visited(n_vtx, false);
+        std::deque<gfa::DirectedSegment> queue;
+        for (uint32_t inner_s = 0; inner_s < n_vtx; ++inner_s) {
+            if (visited[inner_s])
+                continue;
+            visited[inner_s] = true;
+            queue.push_back(gfa::DirectedSegment::FromInnerVertexT(inner_s));
+            while (!queue.empty()) {
+                auto v = queue.front();
+                queue.pop_front();
+                ++sum;
+                for (gfa::LinkInfo l : adj.outgoing_links(v))
+                    if (!visited[l.end.AsInnerVertexT()]) {
+                        visited[l.end.AsInnerVertexT()] = true;
+                        queue.push_back(l.end);
+                    }
+                for (gfa::LinkInfo l : adj.incoming_links(v))
+                    if (!visited[l.start.AsInnerVertexT()]) {
+                        visited[l.start.AsInnerVertexT()] = true;
+                        queue.push_back(l.start);
+                    }
+            }
+        }
+        return sum;
+    };
+
+    uint64_t scan_sum = 0, bfs_sum = 0;
+    for (const std::string name : {"input", "bfs", "rcm"}) {
+        gfa::SegmentOrder method;
+        gfa::ParseSegmentOrder(name, method);
+        gfa::Graph g;
+        g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::SKIP);
+        const uint32_t n_vtx = gfa_n_vtx(g.get());
+        const size_t link_bytes = g.link_cnt() * sizeof(gfa_arc_t) * 2;
+
+        if (method != gfa::SegmentOrder::INPUT)
+            Report("reorder (" + name + ")", link_bytes, Measure(1, [&]() { g.Reorder(method); }));
+        //average distance between ids of linked segments
+        uint64_t span = 0;
+        for (uint64_t k = 0; k < g.link_cnt(); ++k) {
+            const gfa_arc_t &a = g.get()->arc[k];
+            const uint32_t s = uint32_t(a.v_lv >> 33), t = a.w >> 1;
+            span += s < t ? t - s : s - t;
+        }
+        std::cout << "Average link span: " << std::fixed << std::setprecision(1)
+                  << double(span) / double(std::max(g.link_cnt(), size_t(1))) << std::endl;
+
+        const gfa::CsrGraph csr(g);
+        uint64_t graph_sum = 0, csr_sum = 0;
+        Report("link scan (Graph, " + name + ")", link_bytes,
+               Measure(cfg.repeats, [&]() { graph_sum = scan(g, n_vtx); }));
+        Report("link scan (CsrGraph, " + name + ")", link_bytes,
+               Measure(cfg.repeats, [&]() { csr_sum = scan(csr, n_vtx); }));
+        if (graph_sum != csr_sum || (scan_sum && graph_sum != scan_sum)) {
+            std::cerr << "Link scan results differ" << std::endl;
+            exit(3);
+        }
+        scan_sum = graph_sum;
+        Report("bfs (Graph, " + name + ")", link_bytes,
+               Measure(cfg.repeats, [&]() { graph_sum = bfs(g, n_vtx); }));
+        Report("bfs (CsrGraph, " + name + ")", link_bytes,
+               Measure(cfg.repeats, [&]() { csr_sum = bfs(csr, n_vtx); }));
+        if (graph_sum != csr_sum || (bfs_sum && graph_sum != bfs_sum)) {
+            std::cerr << "BFS results differ" << std::endl;
+            exit(3);
+        }
+        bfs_sum = graph_sum;
+    }
+}
+
+//Resident set size of the process in bytes
+size_t ResidentMemory() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0;
+    statm >> total >> resident;
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+//Loading and teardown of the graph with names, sequences and tags in individual allocations or in the arena
+void BenchmarkStorage(const cmd_cfg &cfg) {
+    const std::vector<std::pair<std::string, std::pair<bool, bool>>> variants = {
+        {"malloc", {false, false}},
+        {"arena", {true, false}},
+        {"arena, huge pages", {true, true}}
+    };
+    for (const auto &variant : variants) {
+        //returning memory of the previous runs to the system
+        malloc_trim(0);
+        const size_t rss_before = ResidentMemory();
+        auto g = std::make_unique<gfa::Graph>();
+        g->set_arena_storage(variant.second.first, variant.second.second);
+        auto start = std::chrono::steady_clock::now();
+        g->open(cfg.graph_in, cfg.threads);
+        std::chrono::duration<double> load_time = std::chrono::steady_clock::now() - start;
+        const size_t rss = ResidentMemory() - rss_before;
+
+        start = std::chrono::steady_clock::now();
+        g.reset();
+        std::chrono::duration<double> teardown_time = std::chrono::steady_clock::now() - start;
+
+        std::cout << std::left << std::setw(20) << variant.first << std::right << std::fixed
+                  << "load " << std::setprecision(3) << load_time.count() << " s, "
+                  << "teardown " << teardown_time.count() << " s, "
+                  << "RSS +" << std::setprecision(1) << double(rss) / (1 << 20) << " MB" << std::endl;
+    }
+}
+
+//Deleting a half of the links (both arcs of each) and a tenth of the segments
+//one by one through gfatools, one by one through Graph and with a DeletionBatch, followed by the cleanup
+void BenchmarkDeletion(const cmd_cfg &cfg) {
+    //symmetric, so that both arcs of a link are picked
+    auto link_picked = [](const gfa_arc_t &a) {
+        return (uint32_t(a.v_lv >> 32) + a.w) % 4 < 2;
+    };
+    auto segment_picked = [](uint32_t s) {
+        return s % 10 == 0;
+    };
+
+    size_t links_left = 0;
+    auto run = [&](const std::string &name, const std::function<void (gfa::Graph &)> &f) {
+        gfa::Graph g;
+        g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::SKIP);
+        const size_t link_bytes = g.link_cnt() * sizeof(gfa_arc_t);
+        Report(name, link_bytes, Measure(1, [&]() { f(g); }));
+        if (links_left && g.link_cnt() != links_left) {
+            std::cerr << "Numbers of remaining links differ" << std::endl;
+            exit(3);
+        }
+        links_left = g.link_cnt();
+    };
+
+    run("gfa_arc_del + gfa_fix_symm_del", [&](gfa::Graph &g) {
+        gfa_t *gfa = g.get();
+        for (uint64_t k = 0; k < gfa->n_arc; ++k)
+            if (link_picked(gfa->arc[k]))
+                gfa_arc_del(gfa, uint32_t(gfa->arc[k].v_lv >> 32), gfa->arc[k].w, 1);
+        for (uint32_t s = 0; s < gfa->n_seg; ++s)
+            if (segment_picked(s))
+                gfa_seg_del(gfa, s);
+        gfa_fix_symm_del(gfa);
+    });
+    run("Graph::DeleteLink + Cleanup", [&](gfa::Graph &g) {
+        const gfa_t *gfa = g.get();
+        for (uint64_t k = 0; k < gfa->n_arc; ++k)
+            if (link_picked(gfa->arc[k]))
+                g.DeleteLink(gfa::LinkInfo::FromInnerArcT(gfa->arc[k], k));
+        for (uint32_t s = 0; s < gfa->n_seg; ++s)
+            if (segment_picked(s))
+                g.DeleteSegment(s);
+        g.Cleanup();
+    });
+    run("DeletionBatch + Apply", [&](gfa::Graph &g) {
+        const gfa_t *gfa = g.get();
+        gfa::DeletionBatch batch(g);
+        for (uint64_t k = 0; k < gfa->n_arc; ++k)
+            if (link_picked(gfa->arc[k]))
+                batch.DeleteLink(gfa::LinkInfo::FromInnerArcT(gfa->arc[k], k));
+        for (uint32_t s = 0; s < gfa->n_seg; ++s)
+            if (segment_picked(s))
+                batch.DeleteSegment(s);
+        g.Apply(batch);
+    });
+    std::cout << "Links left: " << links_left << std::endl;
+}
+
+//Dead-end segments up to max_length removed in a single pass, works both on Graph and GraphOverlay
+template<class G>
+size_t ClipTips(G &g, size_t max_length) {
+    size_t ndel = 0;
+    for (gfa::DirectedSegment v : g.forward_segments()) {
+        if (g.segment_length(v) > max_length)
+            continue;
+        //deleted segments have no links
+        if ((g.no_incoming(v) && !g.no_outgoing(v)) || (g.no_outgoing(v) && !g.no_incoming(v))) {
+            g.DeleteSegment(v);
+            ++ndel;
+        }
+    }
+    return ndel;
+}
+
+//Evaluating several tip clipping thresholds by reloading the graph for each of them and in overlays of a single copy
+void BenchmarkOverlay(const cmd_cfg &cfg) {
+    const std::vector<size_t> thresholds = {100, 300, 1000, 3000, 10000};
+    std::vector<size_t> reload_arcs, overlay_arcs;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t max_length : thresholds) {
+        gfa::Graph g;
+        g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::SKIP);
+        ClipTips(g, max_length);
+        size_t live_arc_cnt = 0;
+        for (gfa::DirectedSegment v : g.directed_segments())
+            live_arc_cnt += g.outgoing_link_cnt(v);
+        reload_arcs.push_back(live_arc_cnt);
+    }
+    std::chrono::duration<double> reload_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    gfa::Graph g;
+    g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::SKIP);
+    std::chrono::duration<double> load_time = std::chrono::steady_clock::now() - start;
+    for (size_t max_length : thresholds) {
+        gfa::GraphOverlay overlay(g);
+        ClipTips(overlay, max_length);
+        overlay_arcs.push_back(overlay.live_arc_cnt());
+    }
+    std::chrono::duration<double> overlay_time = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::fixed << std::setprecision(3)
+              << thresholds.size() << " variants, reloading: " << reload_time.count() << " s" << std::endl
+              << thresholds.size() << " variants, overlays: " << overlay_time.count() << " s"
+              << " (single load " << load_time.count() << " s)" << std::endl;
+    for (size_t i = 0; i < thresholds.size(); ++i)
+        std::cout << "max length " << thresholds[i] << ": " << overlay_arcs[i] << " arcs left" << std::endl;
+    if (reload_arcs != overlay_arcs) {
+        std::cerr << "Results differ" << std::endl;
+        exit(3);
+    }
+}
+
+
+//Constructing the graph from in-memory records with GraphBuilder against writing them as GFA and loading it.
+//Records are taken from the input graph (sequences of the remaining segments and canonical links)
+void BenchmarkBuilder(const cmd_cfg &cfg) {
+    std::vector<bool> removed;
+    std::vector<std::string> names, sequences;
+    std::vector<gfa::SegmentLength> lengths;
+    std::vector<gfa::LinkInfo> links;
+    {
+        gfa::Graph g;
+        g.open(cfg.graph_in, cfg.threads);
+        for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s) {
+            const auto seg = g.segment(s);
+            removed.push_back(seg.removed());
+            names.emplace_back(seg.name);
+            sequences.emplace_back(seg.sequence ? seg.sequence : "");
+            lengths.push_back(seg.length);
+        }
+        for (const gfa::LinkInfo &l : g.canonical_links())
+            links.push_back(l);
+    }
+
+    //same records as GFA text
+    auto append_cigar = [](std::string &out, int32_t ov, int32_t ow) {
+        utils::AppendInt(out, std::min(ov, ow));
+        out += 'M';
+        if (ov != ow) {
+            utils::AppendInt(out, std::abs(ov - ow));
+            out += ov > ow ? 'D' : 'I';
+        }
+    };
+    std::string text;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (removed[i])
+            continue;
+        text += "S\t";
+        text += names[i];
+        text += '\t';
+        if (sequences[i].empty()) {
+            text += "*\tLN:i:";
+            utils::AppendInt(text, lengths[i]);
+        } else {
+            text += sequences[i];
+        }
+        text += '\n';
+    }
+    for (const auto &l : links) {
+        text += "L\t";
+        text += names[l.start.segment_id];
+        text += l.start.direction == gfa::Direction::FORWARD ? "\t+\t" : "\t-\t";
+        text += names[l.end.segment_id];
+        text += l.end.direction == gfa::Direction::FORWARD ? "\t+\t" : "\t-\t";
+        append_cigar(text, l.start_overlap, l.end_overlap);
+        text += '\n';
+    }
+
+    const std::string fn = cfg.graph_in + ".bench.gfa";
+    auto text_g = std::make_unique<gfa::Graph>();
+    Report("write GFA + open", text.size(), Measure(cfg.repeats, [&]() {
+        std::ofstream os(fn, std::ios::binary);
+        os.write(text.data(), text.size());
+        os.close();
+        text_g = std::make_unique<gfa::Graph>();
+        text_g->open(fn, cfg.threads);
+    }));
+    std::remove(fn.c_str());
+
+    auto built_g = std::make_unique<gfa::Graph>();
+    Report("GraphBuilder", text.size(), Measure(cfg.repeats, [&]() {
+        gfa::GraphBuilder builder;
+        builder.Reserve(names.size(), links.size());
+        //ids of the source graph -> ids in the builder
+        std::vector<gfa::SegmentId> ids(names.size());
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (removed[i])
+                continue;
+            ids[i] = sequences[i].empty() ? builder.AddSegmentWithLength(names[i], lengths[i])
+                                          : builder.AddSegment(names[i], sequences[i]);
+        }
+        for (const auto &l : links)
+            builder.AddLink(gfa::DirectedSegment(ids[l.start.segment_id], l.start.direction),
+                            gfa::DirectedSegment(ids[l.end.segment_id], l.end.direction),
+                            l.start_overlap, l.end_overlap);
+        built_g = std::make_unique<gfa::Graph>();
+        builder.Build(*built_g);
+    }));
+
+    const gfa_t *a = text_g->get();
+    const gfa_t *b = built_g->get();
+    bool same = a->n_seg == b->n_seg && a->n_arc == b->n_arc;
+    for (uint32_t i = 0; same && i < a->n_seg; ++i) {
+        const gfa_seg_t &x = a->seg[i], &y = b->seg[i];
+        same = strcmp(x.name, y.name) == 0 && x.len == y.len && x.del == y.del
+               && (x.seq && y.seq ? strcmp(x.seq, y.seq) == 0 : x.seq == y.seq);
+    }
+    for (uint64_t k = 0; same && k < a->n_arc; ++k) {
+        const gfa_arc_t &x = a->arc[k], &y = b->arc[k];
+        same = x.v_lv == y.v_lv && x.w == y.w && x.ov == y.ov && x.ow == y.ow && x.del == y.del;
+    }
+    std::cout << "Segment cnt: " << b->n_seg << "; link cnt: " << b->n_arc << std::endl;
+    if (!same) {
+        std::cerr << "Results differ" << std::endl;
+        exit(3);
+    }
+}
+}
+
+int main(int argc, char *argv[]) {
+    using namespace clipp;
+    cmd_cfg cfg;
+
+    const std::map<std::string, std::function<void (const cmd_cfg &)>> benchmarks = {
+        {"tokenizer", BenchmarkTokenizer},
+        {"output", BenchmarkOutput},
+        {"sequence", BenchmarkSequence},
+        {"coverage", BenchmarkCoverage},
+        {"traversal", BenchmarkTraversal},
+        {"locality", BenchmarkLocality},
+        {"storage", BenchmarkStorage},
+        {"deletion", BenchmarkDeletion},
+        {"overlay", BenchmarkOverlay},
+        {"builder", BenchmarkBuilder}
+    };
+
+    auto cli = (
+            cfg.mode << value("benchmark (tokenizer, output, sequence, coverage, traversal, locality, storage, deletion, overlay, builder)"),
+            cfg.graph_in << value("input file in GFA (ending with .gfa)"),
+            (option("--coverage") & value("file", cfg.coverage)) % "file with coverage information (coverage benchmark)",
+            (option("-t", "--threads") & integer("value", cfg.threads)) % "number of threads (default: 1)",
+            (option("-r", "--repeats") & integer("value", cfg.repeats)) % "number of runs, best time is reported (default: 3)"
+    );
+
+    auto result = parse(argc, argv, cli);
+
+    if (!result || !benchmarks.count(cfg.mode)) {
+        std::cerr << "Microbenchmarks of graph loading and processing" << std::endl;
+        std::cerr << make_man_page(cli, argv[0]);
+        exit(1);
+    }
+
+    std::cout << "Best SIMD level: " << utils::tokenizer::LevelName(utils::tokenizer::BestLevel()) << std::endl;
+    benchmarks.at(cfg.mode)(cfg);
+}
@@ -0,0 +1,222 @@
+#include "bgzf.hpp"
+
+#include "utils.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+namespace gfa {
+namespace io {
+namespace bgzf {
+
+namespace {
+
+const size_t FOOTER_SIZE = 8;
+const size_t HEADER_SIZE = 18;
+//Blocks per thread in a single output batch
+const size_t BLOCKS_PER_THREAD = 64;
+
+uint16_t ReadU16(const unsigned char *p) {
+    return uint16_t(p[0] | p[1] << 8);
+}
+
+uint32_t ReadU32(const unsigned char *p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+void WriteU16(unsigned char *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+void WriteU32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i)
+        p[i] = (v >> (8 * i)) & 0xff;
+}
+
+}
+
+bool ParseBlock(const char *data, size_t avail, BlockInfo &info) {
+    const unsigned char *p = (const unsigned char*) data;
+    //magic, deflate, FEXTRA flag
+    if (avail < MIN_HEADER_SIZE || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4))
+        return false;
+
+    const size_t xlen = ReadU16(p + 10);
+    if (avail < 12 + xlen)
+        return false;
+
+    size_t bsize = 0;
+    for (size_t pos = 12; pos + 4 <= 12 + xlen; ) {
+        const size_t slen = ReadU16(p + pos + 2);
+        if (p[pos] == 'B' && p[pos + 1] == 'C' && slen == 2) {
+            bsize = size_t(ReadU16(p + pos + 4)) + 1;
+            break;
+        }
+        pos += 4 + slen;
+    }
+    if (bsize < 12 + xlen + FOOTER_SIZE)
+        return false;
+
+    info.size = bsize;
+    info.data_offset = 12 + xlen;
+    info.data_size = bsize - info.data_offset - FOOTER_SIZE;
+    info.isize = info.crc = 0;
+    if (avail >= bsize) {
+        info.crc = ReadU32(p + bsize - FOOTER_SIZE);
+        info.isize = ReadU32(p + bsize - 4);
+    }
+    return true;
+}
+
+bool InflateBlock(const char *block, const BlockInfo &info, char *out) {
+    if (info.isize > MAX_BLOCK_SIZE)
+        return false;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -15) != Z_OK)
+        return false;
+    zs.next_in = (Bytef*) (block + info.data_offset);
+    zs.avail_in = uInt(info.data_size);
+    //zlib rejects null output buffer even if nothing is to be written (empty EOF block)
+    char dummy;
+    zs.next_out = (Bytef*) (info.isize ? out : &dummy);
+    zs.avail_out = info.isize;
+    int ret = inflate(&zs, Z_FINISH);
+    bool ok = (ret == Z_STREAM_END && zs.total_out == info.isize);
+    inflateEnd(&zs);
+
+    return ok && crc32(crc32(0L, Z_NULL, 0), (const Bytef*) out, info.isize) == info.crc;
+}
+
+bool IsBgzfFile(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+    char header[MIN_HEADER_SIZE + 64];
+    size_t n = fread(header, 1, sizeof(header), f);
+    fclose(f);
+    BlockInfo info;
+    return ParseBlock(header, n, info);
+}
+
+size_t DeflateBlock(const char *data, size_t size, char *out, int level) {
+    assert(size <= BLOCK_DATA_SIZE);
+    unsigned char *p = (unsigned char*) out;
+    //magic, deflate, FEXTRA, mtime, xfl, OS unknown, XLEN=6, 'BC' subfield of length 2
+    static const unsigned char header[HEADER_SIZE - 2] =
+        {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0};
+    memcpy(p, header, sizeof(header));
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return 0;
+    //zlib rejects null input buffer even if there is nothing to compress (EOF block)
+    char dummy = 0;
+    zs.next_in = (Bytef*) (size ? data : &dummy);
+    zs.avail_in = uInt(size);
+    zs.next_out = p + HEADER_SIZE;
+    zs.avail_out = uInt(MAX_BLOCK_SIZE - HEADER_SIZE - FOOTER_SIZE);
+    int ret = deflate(&zs, Z_FINISH);
+    size_t data_size = zs.total_out;
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END)
+        return 0;
+
+    const size_t block_size = HEADER_SIZE + data_size + FOOTER_SIZE;
+    WriteU16(p + 16, uint16_t(block_size - 1));
+    WriteU32(p + HEADER_SIZE + data_size, uint32_t(crc32(crc32(0L, Z_NULL, 0), (const Bytef*) data, uInt(size))));
+    WriteU32(p + HEADER_SIZE + data_size + 4, uint32_t(size));
+    return block_size;
+}
+
+CompressingStreamBuf::CompressingStreamBuf(FILE *f, unsigned thread_cnt, int level):
+        f_(f), thread_cnt_(std::max(thread_cnt, 1u)), level_(level),
+        buf_(thread_cnt_ * BLOCKS_PER_THREAD * BLOCK_DATA_SIZE) {
+    setp(buf_.data(), buf_.data() + buf_.size());
+}
+
+CompressingStreamBuf::~CompressingStreamBuf() {
+    Close();
+}
+
+bool CompressingStreamBuf::CompressAndWrite(const std::vector<char> &data) {
+    const size_t block_cnt = (data.size() + BLOCK_DATA_SIZE - 1) / BLOCK_DATA_SIZE;
+    std::vector<char> out(block_cnt * MAX_BLOCK_SIZE);
+    std::vector<size_t> sizes(block_cnt, 0);
+    utils::RunInParallel(block_cnt, thread_cnt_, [&](size_t i) {
+        size_t start = i * BLOCK_DATA_SIZE;
+        sizes[i] = DeflateBlock(data.data() + start, std::min(BLOCK_DATA_SIZE, data.size() - start),
+                                out.data() + i * MAX_BLOCK_SIZE, level_);
+    });
+    bool ok = true;
+    for (size_t i = 0; i < block_cnt; ++i) {
+        ok &= (sizes[i] > 0);
+        if (ok)
+            ok = fwrite(out.data() + i * MAX_BLOCK_SIZE, 1, sizes[i], f_) == sizes[i];
+    }
+    return ok;
+}
+
+bool CompressingStreamBuf::Wait() {
+    if (pending_.valid())
+        ok_ &= pending_.get();
+    return ok_;
+}
+
+void CompressingStreamBuf::Submit(bool whole_blocks) {
+    size_t size = pptr() - pbase();
+    if (whole_blocks)
+        size -= size % BLOCK_DATA_SIZE;
+    if (size == 0)
+        return;
+    Wait();
+    pending_buf_.assign(pbase(), pbase() + size);
+    //moving the remainder to the start of the buffer
+    const size_t rest = pptr() - pbase() - size;
+    memmove(buf_.data(), pbase() + size, rest);
+    setp(buf_.data(), buf_.data() + buf_.size());
+    pbump(int(rest));
+    pending_ = std::async(std::launch::async, [this]() {
+        return CompressAndWrite(pending_buf_);
+    });
+}
+
+CompressingStreamBuf::int_type CompressingStreamBuf::overflow(int_type c) {
+    if (closed_)
+        return traits_type::eof();
+    Submit();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return ok_ ? traits_type::not_eof(c) : traits_type::eof();
+}
+
+int CompressingStreamBuf::sync() {
+    if (closed_)
+        return -1;
+    Submit(/*whole blocks*/true);
+    return ok_ ? 0 : -1;
+}
+
+bool CompressingStreamBuf::Close() {
+    if (closed_)
+        return ok_;
+    Submit();
+    Wait();
+    //empty block marks the end of file
+    std::vector<char> eof_block(MAX_BLOCK_SIZE);
+    size_t n = DeflateBlock(nullptr, 0, eof_block.data(), level_);
+    ok_ &= (n > 0 && fwrite(eof_block.data(), 1, n, f_) == n);
+    ok_ &= (fclose(f_) == 0);
+    closed_ = true;
+    return ok_;
+}
+
+}
+}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace gfa {
+namespace io {
+namespace bgzf {
+
+//BGZF is a series of gzip members (blocks) of at most 64Kb each,
+//with the size of every block stored in the 'BC' extra field of its header.
+//This allows to find block boundaries without decompression and
+//to process blocks independently.
+const size_t MAX_BLOCK_SIZE = 1 << 16;
+
+//Header is at least 18 bytes (fixed part and 'BC' subfield)
+const size_t MIN_HEADER_SIZE = 18;
+
+//Amount of data put into a single block on output (same as bgzip),
+//leaves room for the header and footer even if data is incompressible
+const size_t BLOCK_DATA_SIZE = 0xff00;
+
+struct BlockInfo {
+    //size of the whole block including header and footer
+    size_t size;
+    //compressed (raw deflate) data
+    size_t data_offset;
+    size_t data_size;
+    //uncompressed size and its crc32, taken from the footer
+    uint32_t isize;
+    uint32_t crc;
+};
+
+//Returns false if the data doesn't start with a BGZF block header.
+//If the block is only partially available, info.size is set, but footer fields are not
+bool ParseBlock(const char *data, size_t avail, BlockInfo &info);
+
+//Decompresses complete block into out (has to have room for info.isize bytes) and checks crc
+bool InflateBlock(const char *block, const BlockInfo &info, char *out);
+
+//Checks header of the first block
+bool IsBgzfFile(const std::string &filename);
+
+//Compresses at most BLOCK_DATA_SIZE bytes into a complete block,
+//out has to have room for MAX_BLOCK_SIZE bytes. Returns block size (0 on failure).
+size_t DeflateBlock(const char *data, size_t size, char *out, int level);
+
+//Output buffer compressing data into BGZF blocks.
+//Filled batch is compressed by a thread pool and written while the next one is being filled.
+class CompressingStreamBuf : public std::streambuf {
+    FILE *f_;
+    const unsigned thread_cnt_;
+    const int level_;
+    std::vector<char> buf_;
+    //batch being compressed and written
+    std::vector<char> pending_buf_;
+    std::future<bool> pending_;
+    bool ok_ = true;
+    bool closed_ = false;
+
+    bool CompressAndWrite(const std::vector<char> &data);
+
+    //Hands off currently buffered data.
+    //With whole_blocks only complete blocks are handed off and the remainder stays buffered
+    void Submit(bool whole_blocks = false);
+
+    bool Wait();
+
+protected:
+    int_type overflow(int_type c) override;
+
+    //Stream flushes (e.g. std::endl) only hand off complete blocks,
+    //the last partial block is only written by Close
+    int sync() override;
+
+public:
+    //Takes ownership of f
+    //Fastest level is used by default, outputs are mostly intermediate graphs
+    CompressingStreamBuf(FILE *f, unsigned thread_cnt, int level = 1);
+
+    CompressingStreamBuf(const CompressingStreamBuf&) = delete;
+    CompressingStreamBuf& operator=(const CompressingStreamBuf&) = delete;
+
+    ~CompressingStreamBuf();
+
+    //Flushes remaining data, appends EOF marker block and closes the file
+    bool Close();
+};
+
+}
+}
+}
@@ -25,8 +25,8 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
     ) % "algorithm settings");
 
     auto result = parse(argc, argv, cli);
-    if (cfg.use_coverage && cfg.coverage.empty()) {
-        std::cerr << "Option to use coverage values was enabled, but coverage file wasn't provided" << std::endl;
+    if (cfg.use_coverage && !cfg.has_coverage()) {
+        std::cerr << "Option to use coverage values was enabled, but neither coverage file nor coverage tag was provided" << std::endl;
         exit(2);
     }
 
@@ -43,30 +43,26 @@ int main(int argc, char *argv[]) {
     std::cout << "Max length set to " << cfg.max_length << std::endl;
     std::cout << "Max length diff set to " << cfg.max_diff << std::endl;
 
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     bubbles::SuperbubbleFinder::SegmentCoverageF segment_cov_f;
     if (cfg.use_coverage) {
-        assert(segment_cov_ptr);
+        assert(g.has_coverage());
         segment_cov_f = [&](gfa::DirectedSegment v) {
-            return double(utils::get(*segment_cov_ptr, g.segment_name(v)));
+            return g.coverage(v);
         };
     }
 
     std::cout << "Searching for bubbles" << std::endl;
-    std::set<gfa::DirectedSegment> v_in_bubble;
+    utils::DenseSet<gfa::DirectedSegment> v_in_bubble(2 * size_t(g.segment_cnt()));
     std::set<std::pair<gfa::DirectedSegment, gfa::DirectedSegment>> l_in_bubble;
     //consist of heaviest paths of outermost bubbles
-    std::set<uint32_t> segments_to_keep;
+    utils::DenseSet<gfa::SegmentId> segments_to_keep(g.segment_cnt());
     std::set<std::pair<gfa::DirectedSegment, gfa::DirectedSegment>> links_to_keep;
     //FIXME replace with iterator
     for (gfa::DirectedSegment v : g.directed_segments()) {
@@ -130,23 +126,26 @@ int main(int argc, char *argv[]) {
     size_t l_ndel = 0;
     size_t v_ndel = 0;
 
+    //sweeping everything marked at once
+    gfa::DeletionBatch batch(g);
     //TODO currently same link will be marked for deletion twice
     for (auto l_desc : l_in_bubble) {
         if (links_to_keep.count(l_desc) == 0) {
             ++l_ndel;
-            g.DeleteLink(l_desc.first, l_desc.second);
+            batch.DeleteLink(l_desc.first, l_desc.second);
         }
     }
 
-    //TODO currently same segment can be marked for deletion twice
-    for (auto v : v_in_bubble) {
-        if (segments_to_keep.count(v.segment_id) == 0) {
+    for (gfa::SegmentId s = 0; s < g.segment_cnt(); ++s) {
+        if ((v_in_bubble.count(gfa::DirectedSegment::Forward(s)) || v_in_bubble.count(gfa::DirectedSegment::Reverse(s)))
+                && segments_to_keep.count(s) == 0) {
             ++v_ndel;
-            g.DeleteSegment(v);
+            batch.DeleteSegment(s);
         }
     }
+    g.Apply(batch);
 
     //std::cout << "Total of " << l_ndel << " links and " << v_ndel << " segments removed" << std::endl;
-    tooling::OutputGraph(g, cfg, (l_ndel + v_ndel) == 0 ? 0 : size_t(-1), segment_cov_ptr.get());
+    tooling::OutputGraph(g, cfg, (l_ndel + v_ndel) == 0 ? 0 : size_t(-1));
     std::cout << "END" << std::endl;
 }
@@ -1,88 +1,59 @@
 #pragma once
 
 #include "wrapper.hpp"
+#include "graph_builder.hpp"
 #include "utils.hpp"
 
 #include <iostream>
 #include <string>
-#include <map>
 #include <set>
 #include <functional>
 #include <cmath>
 
 namespace gfa {
 
-inline
-char ComplementNucl(char c) {
-    switch (c) {
-        case 'A':
-            return 'T';
-        case 'a':
-            return 't';
-        case 'C':
-            return 'G';
-        case 'c':
-            return 'g';
-        case 'G':
-            return 'C';
-        case 'g':
-            return 'c';
-        case 'T':
-            return 'A';
-        case 't':
-            return 'a';
-        default:
-            return c;
-    }
-}
-
-//TODO optimize
 inline
 std::string ReverseComplement(const std::string &s) {
     std::string answer;
-    for (int32_t i = s.size() - 1; i >= 0; --i) {
-        answer += ComplementNucl(s[i]);
-    }
+    AppendReverseComplement(s.data(), s.size(), 0, answer);
     return answer;
 }
 
+//Appends sequence spelled by the path to out
 inline
-std::string PathSequence(const Graph &g, const Path &p) {
+void AppendPathSequence(const Graph &g, const Path &p, std::string &out) {
     assert(!p.segments.empty());
-    const auto first_seg = g.segment(p.segments.front());
-
-    std::string result = !first_seg.sequence ? "" : std::string(first_seg.sequence);
-
-    if (p.segments.front().direction == Direction::REVERSE)
-        result = ReverseComplement(result);
+    const size_t start = out.size();
+    g.AppendSequence(p.segments.front(), 0, out);
 
     for (auto l : p.links) {
         const auto seg_info = g.segment(l.end);
         assert(seg_info.length > 0);
         assert(l.end_overlap >= 0);
-        if (uint32_t(l.end_overlap) >= seg_info.length) {
+        if (SegmentLength(l.end_overlap) >= seg_info.length) {
             WARN("Overlap is longer than (or equal to) segment");
         }
-        auto trim = std::min(seg_info.length - 1, uint32_t(l.end_overlap));
-
-        if (!result.empty()) {
-            std::string trimmed;
-
-            //FIXME optimize
-            if (l.end.direction == Direction::FORWARD)
-                trimmed = std::string(seg_info.sequence + trim);
-            else
-                trimmed = ReverseComplement(std::string(seg_info.sequence)).substr(trim);
+        auto trim = std::min(seg_info.length - 1, SegmentLength(l.end_overlap));
 
-            assert(trimmed.size() == seg_info.length - trim);
-            result += trimmed;
+        if (out.size() > start) {
+            size_t prev_size = out.size();
+            g.AppendSequence(l.end, trim, out);
+            assert(out.size() - prev_size == seg_info.length - trim);
         }
     }
+}
+
+inline
+std::string PathSequence(const Graph &g, const Path &p) {
+    std::string result;
+    AppendPathSequence(g, p, result);
     return result;
 }
 
 class UnambiguousFinder {
     const Graph &g_;
+    //segments of the path being extended, reset for every search
+    mutable utils::VisitedSet<SegmentId> used_;
 
     LinkInfo UnambigExtension(DirectedSegment v) const {
         if (g_.unique_outgoing(v)) {
@@ -96,17 +67,17 @@ class UnambiguousFinder {
 
     Path UnambigForward(DirectedSegment v_init) const {
         DEBUG("Searching for non-branching path forward from " << g_.str(v_init));
-        std::set<SegmentId> used;
-        used.insert(v_init.segment_id);
+        used_.clear();
+        used_.insert(v_init.segment_id);
         Path ua_path(v_init);
         LinkInfo l;
         auto v = v_init;
         while ((l = UnambigExtension(v)) != LinkInfo()) {
             v = l.end;
-            if (used.count(v.segment_id) == 0) {
+            if (used_.count(v.segment_id) == 0) {
                 DEBUG("Extending path by " << g_.str(l));
                 ua_path.Extend(l);
-                used.insert(v.segment_id);
+                used_.insert(v.segment_id);
             } else {
                 DEBUG("Cycle detected, couldn't extend beyond " << g_.str(l.start));
                 break;
@@ -136,11 +107,12 @@ class UnambiguousFinder {
     }
 
 public:
-    UnambiguousFinder(const Graph &g): g_(g) {}
+    UnambiguousFinder(const Graph &g): g_(g), used_(g.segment_cnt()) {}
 
     void OutputUnambiguous(const std::string &fn) const {
         std::ofstream out(fn);
-        for (gfa::DirectedSegment v : g_.directed_segments()) {
+        std::string record;
+        for (gfa::DirectedSegment v : g_.forward_segments()) {
             DEBUG("Considering segment " << g_.str(v));
             //TODO remove?
             if (g_.segment(v).removed()) {
@@ -148,12 +120,6 @@ public:
                 continue;
             }
 
-            //TODO add forward-only iterator
-            if (v.direction == gfa::Direction::REVERSE) {
-                DEBUG("Skipping " << g_.str(v));
-                continue;
-            }
-
             auto ua_path = UnambigPath(v);
             assert(!ua_path.segments.empty());
 
@@ -162,10 +128,15 @@ public:
                 assert(!g_.segment(ds).removed());
             }
 
-            std::string name = ">" + g_.segment_name(v) + "_ext";
-            std::string seq = PathSequence(g_, ua_path);
-            assert(!seq.empty());
-            out << name << '\n' << seq << '\n';
+            record.clear();
+            record += '>';
+            record += g_.segment_name(v);
+            record += "_ext\n";
+            const size_t seq_start = record.size();
+            AppendPathSequence(g_, ua_path, record);
+            assert(record.size() > seq_start);
+            record += '\n';
+            out.write(record.data(), record.size());
         }
     }
 
@@ -175,7 +146,8 @@ public:
 class Compactifier {
     const Graph &g_;
     std::string name_prefix_;
-    std::function<double (const std::string&)> coverage_f_;
+    //segment coverage of the graph is used for compacted segments
+    const bool use_coverage_;
     //Vertex size, enables DBG mode of coverage transformation
     const int32_t k_;
     const bool normalize_ovls_;
@@ -194,7 +166,6 @@ class Compactifier {
 
     Path NonbranchingForward(DirectedSegment v_init) const {
         DEBUG("Searching for non-branching path forward from " << g_.str(v_init));
-        std::set<SegmentId> used;
         Path nb_path(v_init);
         LinkInfo l;
         auto v = v_init;
@@ -231,8 +202,9 @@ class Compactifier {
         return nb_path;
     }
 
-    std::tuple<std::string, std::size_t, double> CompactedSequence(const Path &p,
-                                                                   bool drop_sequence) const {
+    //Appends compacted sequence to out (unless drop_sequence), returns its length and coverage
+    std::pair<std::size_t, double> CompactedSequence(const Path &p, bool drop_sequence,
+                                                     std::string &out) const {
         assert(!p.segments.empty());
         const auto first_seg = g_.segment(p.segments.front());
         std::size_t total_len = first_seg.length;
@@ -240,31 +212,33 @@ class Compactifier {
         //TODO think more about coverage averaging computation
         std::size_t len_sum = total_len;
         double coverage = 0.;
-        if (coverage_f_) {
-            coverage += coverage_f_(first_seg.name) * (first_seg.length - k_);
+        if (use_coverage_) {
+            coverage += g_.coverage(p.segments.front()) * (first_seg.length - k_);
         }
 
         for (auto l : p.links) {
             const auto seg_info = g_.segment(l.end);
             assert(seg_info.length > 0);
             assert(l.end_overlap >= 0);
-            if (uint32_t(l.end_overlap) >= seg_info.length) {
+            if (SegmentLength(l.end_overlap) >= seg_info.length) {
                 WARN("Overlap is longer than (or equal to) segment");
             }
             assert(k_ == 0 || l.end_overlap == k_);
-            auto trim = std::min(seg_info.length - 1, uint32_t(l.end_overlap));
+            auto trim = std::min(seg_info.length - 1, SegmentLength(l.end_overlap));
             total_len += seg_info.length - trim;
             len_sum += seg_info.length;
-            if (coverage_f_) {
-                coverage += coverage_f_(seg_info.name) * (seg_info.length - k_);
+            if (use_coverage_) {
+                coverage += g_.coverage(l.end) * (seg_info.length - k_);
             }
         }
 
-        std::string result = drop_sequence ? "" : PathSequence(g_, p);
+        const size_t start = out.size();
+        if (!drop_sequence)
+            AppendPathSequence(g_, p, out);
 
-        assert(result.empty() || result.size() == total_len);
+        assert(out.size() == start || out.size() - start == total_len);
         std::size_t denom = (k_ == 0) ? len_sum : (total_len - k_);
-        return std::make_tuple(result, total_len, coverage / denom);
+        return std::make_pair(total_len, coverage / denom);
     }
 
     std::string FormName(std::size_t compact_cnt) const {
@@ -274,27 +248,26 @@ class Compactifier {
 public:
     Compactifier(const Graph &g,
                  std::string name_prefix = "m_",
-                 const utils::SegmentCoverageMap *segment_cov_ptr = nullptr,
+                 bool use_coverage = false,
                  int32_t k = 0,
                  bool normalize_ovls = false):
-        g_(g), name_prefix_(std::move(name_prefix)), k_(k), normalize_ovls_(normalize_ovls) {
+        g_(g), name_prefix_(std::move(name_prefix)), use_coverage_(use_coverage),
+        k_(k), normalize_ovls_(normalize_ovls) {
         assert(k_ >= 0);
-
-        if (segment_cov_ptr) {
-            coverage_f_ = [=](const std::string &s_name) {
-                assert(segment_cov_ptr);
-                return double(utils::get(*segment_cov_ptr, s_name));
-            };
-        }
+        assert(!use_coverage_ || g_.has_coverage());
 
         if (name_prefix_ == "_")
             name_prefix_ = "";
     }
 
-    void Compact(const std::string &out_fn,
-                 const std::string &mapping_fn = "",
-                 bool drop_sequence = false,
-                 bool rename_all = false) const {
+    //Reports every compacted segment as segment_f(name, sequence, length, coverage)
+    //(sequence is empty if dropped, coverage is only meaningful with use_coverage)
+    //and every link between them as link_f(start name, start direction, end name, end direction, overlap)
+    template<class SegmentF, class LinkF>
+    void CompactRecords(SegmentF segment_f, LinkF link_f,
+                        const std::string &mapping_fn = "",
+                        bool drop_sequence = false,
+                        bool rename_all = false) const {
         if (k_ != 0) {
             INFO("DBG mode enabled with K=" << k_);
         }
@@ -302,30 +275,28 @@ public:
         //Do not forget to check both link and complement
         std::set<LinkInfo> inner_links;
         //original segment name to compacted count and orientation 'match'
-        std::map<SegmentId, std::pair<std::string, bool>> orig2new;
+        utils::PropertyVector<SegmentId, std::pair<std::string, bool>> orig2new(g_.segment_cnt());
 
-        std::ofstream out(out_fn);
         std::ofstream mapping_out;
         if (!mapping_fn.empty()) {
             mapping_out.open(mapping_fn, std::ios_base::app);
         }
 
-        out << "H\tVN:Z:1.0" << "\n";
-        //S       utg000026l      *       LN:i:18541      RC:i:166869
-        //L       m113_3  +       utg511904l      -       9240M
+        //reused for every segment
+        std::string line;
+        std::string seq;
 
         {
-            std::set<SegmentId> used_segments;
+            utils::DenseSet<SegmentId> used_segments(g_.segment_cnt());
             size_t compact_cnt = 0;
-            for (gfa::DirectedSegment v : g_.directed_segments()) {
+            for (gfa::DirectedSegment v : g_.forward_segments()) {
                 DEBUG("Considering segment " << g_.str(v));
                 if (g_.segment(v).removed()) {
                     DEBUG("Removed segment " << g_.str(v));
                     continue;
                 }
 
-                //TODO add forward-only iterator
-                if (v.direction == gfa::Direction::REVERSE || used_segments.count(v.segment_id)) {
+                if (used_segments.count(v.segment_id)) {
                     DEBUG("Skipping " << g_.str(v));
                     continue;
                 }
@@ -349,12 +320,17 @@ public:
                 std::string name;
                 if (nb_path.links.empty() && !rename_all) {
                     //keeping the name if trivial path
-                    name = g_.segment_name(start);
+                    name = std::string(g_.segment_name(start));
                 } else {
                     name = FormName(++compact_cnt);
                     DEBUG("Compacting path " << g_.str(nb_path) << " into " << name);
                     if (!mapping_fn.empty()) {
-                        mapping_out << name << " " << g_.str(nb_path, ",") << "\n";
+                        line.clear();
+                        line += name;
+                        line += ' ';
+                        g_.AppendStr(line, nb_path, ",");
+                        line += '\n';
+                        mapping_out.write(line.data(), line.size());
                     }
                 }
 
@@ -367,34 +343,25 @@ public:
                 }
 
                 //compacted seq/len/cov
-                std::string cs;
+                seq.clear();
                 std::size_t cl;
                 double cc;
-                std::tie(cs, cl, cc) = CompactedSequence(nb_path, drop_sequence);
-
-                out << "S\t" << name <<
-                    "\t" << (cs.empty() ? "*" : cs) <<
-                    "\tLN:i:" << std::to_string(cl);
-
-                if (coverage_f_) {
-                    //adding Mikko-style output to simplify scripting
-                    out << "\tRC:i:" << uint64_t(std::round(cc * cl));
-                    out << "\tll:f:" << std::round(cc * 1000) / 1000;
-                }
-                out << "\n";
+                std::tie(cl, cc) = CompactedSequence(nb_path, drop_sequence, seq);
+                segment_f(name, seq, cl, cc);
             }
         }
 
-        auto get_compacted = [&] (DirectedSegment v) {
+        //name and direction of the compacted segment containing v
+        auto compacted = [&] (DirectedSegment v) {
             //if (orig2new.count(v.segment_id) == 0) {
             //    WARN("Couldn't find corresponding new unitig for " << g_.str(v));
             //}
-            auto new_id_o = utils::get(orig2new, v.segment_id);
+            const auto &new_id_o = orig2new[v.segment_id];
+            assert(!new_id_o.first.empty());
             auto d = v.direction;
             if (!new_id_o.second)
                 d = Swap(d);
-
-            return new_id_o.first + "\t" + PrintDirection(d);
+            return std::make_pair(std::string_view(new_id_o.first), d);
         };
 
         for (DirectedSegment v : g_.directed_segments()) {
@@ -403,7 +370,7 @@ public:
                 continue;
             }
             for (auto l : g_.outgoing_links(v)) {
-                if (!l.IsCanonical())
+                if (!g_.IsCanonical(l))
                     continue;
 
                 if (inner_links.count(l) || inner_links.count(l.Complement()))
@@ -419,13 +386,99 @@ public:
                     ovl = ovl_bound;
                 }
 
-                //TODO support CIGAR?
-                out <<"L\t" << get_compacted(l.start)
-                    << "\t" << get_compacted(l.end)
-                    << "\t" << ovl << "M" << "\n";
+                const auto s = compacted(l.start);
+                const auto e = compacted(l.end);
+                link_f(s.first, s.second, e.first, e.second, ovl);
             }
         }
     }
+
+    //Writes compacted graph as GFA text, returns false if the output couldn't be written.
+    //compress enables BGZF-compressed output using thread_cnt threads
+    bool Compact(const std::string &out_fn,
+                 const std::string &mapping_fn = "",
+                 bool drop_sequence = false,
+                 bool rename_all = false,
+                 bool compress = false,
+                 unsigned thread_cnt = 1) const {
+        auto out_ptr = io::OpenOutputStream(out_fn, compress, thread_cnt);
+        std::ostream &out = *out_ptr;
+
+        out << "H\tVN:Z:1.0" << "\n";
+        //reused for every output line
+        std::string line;
+        //S       utg000026l      *       LN:i:18541      RC:i:166869
+        //L       m113_3  +       utg511904l      -       9240M
+
+        auto output_segment = [&] (const std::string &name, const std::string &seq, std::size_t cl, double cc) {
+            line.clear();
+            line += "S\t";
+            line += name;
+            line += '\t';
+            if (seq.empty())
+                line += '*';
+            else
+                line += seq;
+            line += "\tLN:i:";
+            utils::AppendInt(line, cl);
+
+            if (use_coverage_) {
+                //adding Mikko-style output to simplify scripting
+                line += "\tRC:i:";
+                utils::AppendInt(line, uint64_t(std::round(cc * cl)));
+                line += "\tll:f:";
+                utils::AppendDouble(line, std::round(cc * 1000) / 1000);
+            }
+            line += '\n';
+            out.write(line.data(), line.size());
+        };
+
+        //TODO support CIGAR?
+        auto output_link = [&] (std::string_view start, Direction start_d,
+                                std::string_view end, Direction end_d, size_t ovl) {
+            line.clear();
+            line += "L\t";
+            line += start;
+            line += '\t';
+            line += PrintDirection(start_d);
+            line += '\t';
+            line += end;
+            line += '\t';
+            line += PrintDirection(end_d);
+            line += '\t';
+            utils::AppendInt(line, ovl);
+            line += "M\n";
+            out.write(line.data(), line.size());
+        };
+
+        CompactRecords(output_segment, output_link, mapping_fn, drop_sequence, rename_all);
+        return io::CloseOutputStream(out);
+    }
+
+    //Builds compacted graph in memory (e.g. to be stored as a snapshot), same as loading the GFA written by Compact.
+    //Compacted segments get exact coverage values instead of the rounded 'll' tags
+    void Compact(Graph &compacted,
+                 const std::string &mapping_fn = "",
+                 bool drop_sequence = false,
+                 bool rename_all = false) const {
+        GraphBuilder builder;
+        auto add_segment = [&] (const std::string &name, const std::string &seq, std::size_t cl, double cc) {
+            const double coverage = use_coverage_ ? cc : GraphBuilder::NO_COVERAGE;
+            if (seq.empty())
+                builder.AddSegmentWithLength(name, SegmentLength(cl), coverage);
+            else
+                builder.AddSegment(name, seq, coverage);
+        };
+
+        auto add_link = [&] (std::string_view start, Direction start_d,
+                             std::string_view end, Direction end_d, size_t ovl) {
+            builder.AddLink(DirectedSegment(builder.AddName(start), start_d),
+                            DirectedSegment(builder.AddName(end), end_d), int32_t(ovl));
+        };
+
+        CompactRecords(add_segment, add_link, mapping_fn, drop_sequence, rename_all);
+        builder.Build(compacted);
+    }
 };
 
 //inline void CompactAndWrite(const Graph &g, const std::string &fn) {
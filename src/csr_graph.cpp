@@ -0,0 +1,39 @@
+#include "csr_graph.hpp"
+
+namespace gfa {
+
+CsrGraph::CsrGraph(const Graph &g): g_(g) {
+    const gfa_t *gfa = g.get();
+    const uint32_t n_vtx = gfa_n_vtx(gfa);
+
+    auto alive_cnt = [&](uint32_t v) {
+        const gfa_arc_t *a = gfa_arc_a(gfa, v);
+        uint64_t cnt = 0;
+        for (uint32_t i = 0, n = gfa_arc_n(gfa, v); i < n; ++i)
+            cnt += !a[i].del;
+        return cnt;
+    };
+
+    //incoming links of v are complements of outgoing links of its complement (v ^ 1)
+    offsets_.assign(2 * size_t(n_vtx) + 1, 0);
+    for (uint32_t v = 0; v < n_vtx; ++v) {
+        offsets_[2 * size_t(v) + 1] = offsets_[2 * size_t(v)] + alive_cnt(v);
+        offsets_[2 * size_t(v) + 2] = offsets_[2 * size_t(v) + 1] + alive_cnt(v ^ 1);
+    }
+
+    arcs_.resize(offsets_.back());
+    for (uint32_t v = 0; v < n_vtx; ++v) {
+        Arc *out = arcs_.data() + offsets_[2 * size_t(v)];
+        Arc *in = arcs_.data() + offsets_[2 * size_t(v ^ 1) + 1];
+        const gfa_arc_t *a = gfa_arc_a(gfa, v);
+        for (uint32_t i = 0, n = gfa_arc_n(gfa, v); i < n; ++i) {
+            if (a[i].del)
+                continue;
+            *out++ = Arc{a[i].w, a[i].ov, a[i].ow};
+            *in++ = Arc{a[i].w ^ 1, a[i].ow, a[i].ov};
+        }
+        assert(out == arcs_.data() + offsets_[2 * size_t(v) + 1]);
+    }
+}
+
+}
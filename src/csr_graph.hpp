@@ -0,0 +1,168 @@
+#pragma once
+
+#include "wrapper.hpp"
+
+#include <vector>
+
+namespace gfa {
+
+class CsrLinkIterator;
+
+//Immutable adjacency snapshot of a Graph in compressed sparse row layout.
+//Outgoing links of every directed segment are immediately followed by its (pre-complemented)
+//incoming links in a single array, so traversals don't touch gfa_arc_t records.
+//Links are listed in the same order as by Graph; deleted links are skipped.
+//Has to be rebuilt if the source graph is modified; names, lengths, etc. are taken from graph().
+class CsrGraph {
+public:
+    struct Arc {
+        //inner vertex id of the other end
+        InnerVertexId v;
+        int32_t start_overlap;
+        int32_t end_overlap;
+    };
+
+private:
+    const Graph &g_;
+    //outgoing links of inner vertex v are [offsets_[2v], offsets_[2v + 1]),
+    //incoming ones are [offsets_[2v + 1], offsets_[2v + 2])
+    std::vector<uint64_t> offsets_;
+    std::vector<Arc> arcs_;
+
+public:
+    explicit CsrGraph(const Graph &g);
+
+    CsrGraph(const CsrGraph&) = delete;
+    CsrGraph& operator=(const CsrGraph&) = delete;
+
+    const Graph &graph() const { return g_; }
+
+    uint32_t vertex_cnt() const { return uint32_t(offsets_.size() / 2); }
+
+    //every link is stored both as outgoing and incoming
+    size_t link_cnt() const { return arcs_.size() / 2; }
+
+    uint32_t outgoing_link_cnt(DirectedSegment v) const {
+        const size_t i = 2 * size_t(v.AsInnerVertexT());
+        return uint32_t(offsets_[i + 1] - offsets_[i]);
+    }
+
+    bool unique_outgoing(DirectedSegment v) const {
+        return outgoing_link_cnt(v) == 1;
+    }
+
+    bool no_outgoing(DirectedSegment v) const {
+        return outgoing_link_cnt(v) == 0;
+    }
+
+    uint32_t incoming_link_cnt(DirectedSegment v) const {
+        const size_t i = 2 * size_t(v.AsInnerVertexT()) + 1;
+        return uint32_t(offsets_[i + 1] - offsets_[i]);
+    }
+
+    bool unique_incoming(DirectedSegment v) const {
+        return incoming_link_cnt(v) == 1;
+    }
+
+    bool no_incoming(DirectedSegment v) const {
+        return incoming_link_cnt(v) == 0;
+    }
+
+    //Raw arcs, Arc::v is the end of outgoing and the start of incoming links
+    const Arc *outgoing_arcs(DirectedSegment v) const {
+        return arcs_.data() + offsets_[2 * size_t(v.AsInnerVertexT())];
+    }
+
+    const Arc *incoming_arcs(DirectedSegment v) const {
+        return arcs_.data() + offsets_[2 * size_t(v.AsInnerVertexT()) + 1];
+    }
+
+    inline CsrLinkIterator outgoing_begin(DirectedSegment v) const;
+
+    inline CsrLinkIterator outgoing_end(DirectedSegment v) const;
+
+    inline utils::ProxyContainer<CsrLinkIterator> outgoing_links(DirectedSegment v) const;
+
+    inline CsrLinkIterator incoming_begin(DirectedSegment v) const;
+
+    inline CsrLinkIterator incoming_end(DirectedSegment v) const;
+
+    inline utils::ProxyContainer<CsrLinkIterator> incoming_links(DirectedSegment v) const;
+
+    //Approximate memory footprint in bytes
+    size_t memory() const {
+        return offsets_.capacity() * sizeof(uint64_t) + arcs_.capacity() * sizeof(Arc);
+    }
+};
+
+class CsrLinkIterator {
+    const CsrGraph::Arc *arc_ptr_;
+    DirectedSegment v_;
+    bool incoming_;
+
+public:
+    CsrLinkIterator(const CsrGraph::Arc *arc_ptr, DirectedSegment v, bool incoming) :
+        arc_ptr_(arc_ptr), v_(v), incoming_(incoming) {}
+
+    CsrLinkIterator& operator++() {
+        ++arc_ptr_;
+        return *this;
+    }
+
+    CsrLinkIterator operator++(int) {
+        auto retval = *this;
+        ++(*this);
+        return retval;
+    }
+
+    bool operator==(CsrLinkIterator other) const {
+        return arc_ptr_ == other.arc_ptr_;
+    }
+
+    bool operator!=(CsrLinkIterator other) const {
+        return !(*this == other);
+    }
+
+    LinkInfo operator*() const {
+        LinkInfo answer;
+        const auto w = DirectedSegment::FromInnerVertexT(arc_ptr_->v);
+        answer.start = incoming_ ? w : v_;
+        answer.end = incoming_ ? v_ : w;
+        answer.start_overlap = arc_ptr_->start_overlap;
+        answer.end_overlap = arc_ptr_->end_overlap;
+        return answer;
+    }
+
+    // iterator traits
+    using difference_type = ptrdiff_t;
+    using value_type = LinkInfo;
+    using pointer = const LinkInfo*;
+    using reference = const LinkInfo&;
+    using iterator_category = std::forward_iterator_tag;
+};
+
+CsrLinkIterator CsrGraph::outgoing_begin(DirectedSegment v) const {
+    return CsrLinkIterator(outgoing_arcs(v), v, /*incoming*/false);
+}
+
+CsrLinkIterator CsrGraph::outgoing_end(DirectedSegment v) const {
+    return CsrLinkIterator(outgoing_arcs(v) + outgoing_link_cnt(v), v, /*incoming*/false);
+}
+
+utils::ProxyContainer<CsrLinkIterator> CsrGraph::outgoing_links(DirectedSegment v) const {
+    return utils::ProxyContainer<CsrLinkIterator>(outgoing_begin(v), outgoing_end(v));
+}
+
+CsrLinkIterator CsrGraph::incoming_begin(DirectedSegment v) const {
+    return CsrLinkIterator(incoming_arcs(v), v, /*incoming*/true);
+}
+
+CsrLinkIterator CsrGraph::incoming_end(DirectedSegment v) const {
+    return CsrLinkIterator(incoming_arcs(v) + incoming_link_cnt(v), v, /*incoming*/true);
+}
+
+utils::ProxyContainer<CsrLinkIterator> CsrGraph::incoming_links(DirectedSegment v) const {
+    return utils::ProxyContainer<CsrLinkIterator>(incoming_begin(v), incoming_end(v));
+}
+
+}
@@ -0,0 +1,899 @@
+#include "gfa_io.hpp"
+#include "gfa-priv.h"
+#include "khash.h"
+#include "utils.hpp"
+#include "tokenizer.hpp"
+#include "bgzf.hpp"
+#include "snapshot.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <climits>
+#include <atomic>
+#include <charconv>
+#include <future>
+#include <memory>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//same as the segment name hash of gfatools
+KHASH_MAP_INIT_STR(seg, uint32_t)
+
+namespace gfa {
+namespace io {
+
+namespace {
+
+//aux values are not aligned
+template<class T>
+double AuxValue(const uint8_t *p) {
+    T val;
+    memcpy(&val, p, sizeof(T));
+    return double(val);
+}
+
+}
+
+void DetachArena(gfa_t *g, const utils::Arena &arena) {
+    for (uint32_t i = 0; i < g->n_seg; ++i) {
+        gfa_seg_t &s = g->seg[i];
+        if (arena.contains(s.name))
+            s.name = nullptr;
+        if (arena.contains(s.seq))
+            s.seq = nullptr;
+        if (arena.contains(s.aux.aux))
+            s.aux = gfa_aux_t();
+    }
+}
+
+void MoveName(gfa_t *g, uint32_t sid, utils::Arena &arena) {
+    gfa_seg_t &s = g->seg[sid];
+    if (arena.contains(s.name))
+        return;
+    khash_t(seg) *h = (khash_t(seg)*) g->h_names;
+    khint_t k = kh_get(seg, h, s.name);
+    assert(k != kh_end(h));
+    char *name = arena.CopyString(s.name, strlen(s.name));
+    kh_key(h, k) = name;
+    free(s.name);
+    s.name = name;
+}
+
+void Reserve(gfa_t *g, uint32_t segment_cnt, uint64_t arc_cnt) {
+    if (segment_cnt > g->m_seg) {
+        g->seg = (gfa_seg_t*) realloc(g->seg, segment_cnt * sizeof(gfa_seg_t));
+        memset(g->seg + g->m_seg, 0, (segment_cnt - g->m_seg) * sizeof(gfa_seg_t));
+        g->m_seg = segment_cnt;
+        //khash grows once occupancy exceeds 0.77
+        kh_resize(seg, (khash_t(seg)*) g->h_names, khint_t(segment_cnt / 0.75) + 1);
+    }
+    if (arc_cnt > g->m_arc) {
+        g->arc = (gfa_arc_t*) realloc(g->arc, arc_cnt * sizeof(gfa_arc_t));
+        g->link_aux = (gfa_aux_t*) realloc(g->link_aux, arc_cnt * sizeof(gfa_aux_t));
+        memset(g->arc + g->m_arc, 0, (arc_cnt - g->m_arc) * sizeof(gfa_arc_t));
+        memset(g->link_aux + g->m_arc, 0, (arc_cnt - g->m_arc) * sizeof(gfa_aux_t));
+        g->m_arc = arc_cnt;
+    }
+}
+
+bool CountCoverageTag(const std::string &tag) {
+    return tag == "KC" || tag == "RC";
+}
+
+double TagCoverage(const gfa_aux_t &aux, const char *tag, uint32_t len) {
+    const double NO_VALUE = std::numeric_limits<double>::quiet_NaN();
+    const uint8_t *p = aux.l_aux ? gfa_aux_get(aux.l_aux, aux.aux, tag) : nullptr;
+    if (!p)
+        return NO_VALUE;
+    double val;
+    switch (p[0]) {
+        case 'c': val = AuxValue<int8_t>(p + 1); break;
+        case 'C': val = AuxValue<uint8_t>(p + 1); break;
+        case 's': val = AuxValue<int16_t>(p + 1); break;
+        case 'S': val = AuxValue<uint16_t>(p + 1); break;
+        case 'i': val = AuxValue<int32_t>(p + 1); break;
+        case 'I': val = AuxValue<uint32_t>(p + 1); break;
+        case 'f': val = AuxValue<float>(p + 1); break;
+        default: return NO_VALUE;
+    }
+    if (CountCoverageTag(tag))
+        return len ? val / len : NO_VALUE;
+    return val;
+}
+
+std::vector<double> TagCoverage(const gfa_t *g, const char *tag) {
+    std::vector<double> coverage(g->n_seg);
+    for (uint32_t i = 0; i < g->n_seg; ++i)
+        coverage[i] = TagCoverage(g->seg[i].aux, tag, g->seg[i].len);
+    return coverage;
+}
+
+namespace {
+
+const size_t BATCH_SIZE_PER_THREAD = 16 << 20;
+const size_t CHUNKS_PER_THREAD = 4;
+const size_t MIN_CHUNK_SIZE = 64 << 10;
+//compressed data read at once, expands to roughly BATCH_SIZE_PER_THREAD of text
+const size_t BGZF_BATCH_SIZE_PER_THREAD = 4 << 20;
+
+struct TextBuffer {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    void reserve(size_t n) {
+        if (n <= capacity)
+            return;
+        std::unique_ptr<char[]> tmp(new char[n]);
+        if (size)
+            memcpy(tmp.get(), data.get(), size);
+        data = std::move(tmp);
+        capacity = n;
+    }
+};
+
+//Parsed S or L record. Names are stored as offsets into the chunk name buffer.
+struct Record {
+    char type;
+    size_t name;
+    //S-line only, points into the batch text if sequences go to the arena
+    char *seq;
+    int32_t len;
+    //position in chunk packed sequences (PACKED mode)
+    uint64_t packed_pos;
+    //taken from coverage tag (NaN if absent)
+    double cov;
+    //position of the whole line within the batch (including '\n')
+    size_t line_offset;
+    size_t line_size;
+    //L-line only
+    size_t end_name;
+    bool start_rev;
+    bool end_rev;
+    int32_t ov;
+    int32_t ow;
+
+    gfa_aux_t aux;
+};
+
+struct ParsedChunk {
+    std::string names;
+    PackedSequences packed;
+    std::vector<Record> records;
+    size_t invalid_cnt = 0;
+
+    size_t AddName(const char *b, const char *e) {
+        size_t pos = names.size();
+        names.append(b, e);
+        names.push_back('\0');
+        return pos;
+    }
+};
+
+using utils::tokenizer::Token;
+
+//S-line fields: type, name, sequence, tags
+const size_t S_FIELDS = 4;
+//L-line fields: type, from, from orientation, to, to orientation, overlap, tags
+const size_t L_FIELDS = 7;
+
+//Mirrors gfa_parse_S
+//Separators and the line end are already replaced with 0
+//If borrow_seq is set, sequence is not copied out of the batch text
+bool ParseSegment(const Token *f, size_t cnt, SequenceMode mode, const char *cov_tag, bool borrow_seq,
+                  ParsedChunk &chunk) {
+    if (cnt < 3)
+        return false;
+
+    char *seq = (char*) f[2].b;
+    const bool has_seq = (*seq != '*');
+    Record r = Record();
+    r.type = 'S';
+    r.name = chunk.AddName(f[1].b, f[1].e);
+    //absent sequence without LN tag gives zero length (same as in gfa_read)
+    r.len = has_seq ? int32_t(f[2].size()) : 0;
+    r.packed_pos = PackedSequences::NONE;
+    if (has_seq && mode == SequenceMode::RAW && borrow_seq) {
+        r.seq = seq;
+    } else if (has_seq && mode == SequenceMode::RAW) {
+        r.seq = (char*) malloc(r.len + 1);
+        memcpy(r.seq, seq, r.len + 1);
+    } else if (has_seq && mode == SequenceMode::PACKED) {
+        r.packed_pos = chunk.packed.Pack(seq, r.len);
+    }
+
+    int m_aux = 0;
+    uint8_t *aux = nullptr;
+    int l_aux = cnt > 3 ? gfa_aux_parse((char*) f[3].b, &aux, &m_aux) : 0;
+    uint8_t *s_LN = l_aux ? gfa_aux_get(l_aux, aux, "LN") : nullptr;
+    if (s_LN && s_LN[0] == 'i') {
+        int32_t LN = *(int32_t*)(s_LN + 1);
+        l_aux = gfa_aux_del(l_aux, aux, s_LN);
+        if (!has_seq && LN >= 0)
+            r.len = LN;
+    }
+    r.aux.m_aux = m_aux;
+    r.aux.l_aux = l_aux;
+    r.aux.aux = aux;
+    r.cov = cov_tag ? TagCoverage(r.aux, cov_tag, r.len) : std::numeric_limits<double>::quiet_NaN();
+
+    chunk.records.push_back(r);
+    return true;
+}
+
+//Mirrors gfa_parse_L
+//Separators and the line end are already replaced with 0
+//Missing overlap field is treated as zero overlap
+bool ParseLink(const Token *f, size_t cnt, ParsedChunk &chunk) {
+    if (cnt < 5)
+        return false;
+
+    if ((*f[2].b != '+' && *f[2].b != '-') || (*f[4].b != '+' && *f[4].b != '-'))
+        return false;
+
+    int32_t ov = INT32_MAX, ow = INT32_MAX;
+    char *q = cnt > 5 ? (char*) f[5].b : nullptr;
+    if (!q || *q == '*') {
+        ov = ow = 0;
+    } else if (*q == ':') {
+        ow = isdigit((unsigned char) q[1]) ? strtol(q + 1, nullptr, 10) : INT32_MAX;
+    } else if (isdigit((unsigned char) *q)) {
+        char *r;
+        ov = strtol(q, &r, 10);
+        if (isupper((unsigned char) *r)) {
+            //CIGAR
+            ov = ow = 0;
+            do {
+                long l = strtol(q, &q, 10);
+                if (*q == 'M' || *q == 'D' || *q == 'N') ov += l;
+                if (*q == 'M' || *q == 'I' || *q == 'S') ow += l;
+                ++q;
+            } while (isdigit((unsigned char) *q));
+        } else if (*r == ':') {
+            ow = isdigit((unsigned char) r[1]) ? strtol(r + 1, nullptr, 10) : INT32_MAX;
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    Record r = Record();
+    r.type = 'L';
+    r.name = chunk.AddName(f[1].b, f[1].e);
+    r.start_rev = (*f[2].b != '+');
+    r.end_name = chunk.AddName(f[3].b, f[3].e);
+    r.end_rev = (*f[4].b != '+');
+    r.ov = ov;
+    r.ow = ow;
+
+    int m_aux = 0;
+    uint8_t *aux = nullptr;
+    int l_aux = cnt > 6 ? gfa_aux_parse((char*) f[6].b, &aux, &m_aux) : 0;
+    r.aux.m_aux = m_aux;
+    r.aux.l_aux = l_aux;
+    r.aux.aux = aux;
+
+    chunk.records.push_back(r);
+    return true;
+}
+
+//[b, e) has to end with '\n', line offsets are computed relative to batch start
+void ParseChunk(const char *batch, char *b, char *e, SequenceMode mode, const char *cov_tag, bool borrow_seq,
+                ParsedChunk &chunk) {
+    using namespace utils::tokenizer;
+    Token fields[L_FIELDS];
+    while (b < e) {
+        const bool s_line = (b[0] == 'S' && b[1] == '\t');
+        const bool l_line = (b[0] == 'L' && b[1] == '\t');
+        if (!s_line && !l_line) {
+            b = (char*) FindChar(b, e, '\n') + 1;
+            continue;
+        }
+
+        size_t cnt = 0;
+        char *line_end = (char*) SplitLine(b, e, '\t', fields, s_line ? S_FIELDS : L_FIELDS, cnt);
+        assert(line_end < e);
+        if (fields[cnt - 1].size() > 0 && *(fields[cnt - 1].e - 1) == '\r')
+            --fields[cnt - 1].e;
+        for (size_t i = 0; i < cnt; ++i)
+            *(char*) fields[i].e = 0;
+
+        bool ok = s_line ? ParseSegment(fields, cnt, mode, cov_tag, borrow_seq, chunk) : ParseLink(fields, cnt, chunk);
+        if (!ok) {
+            ++chunk.invalid_cnt;
+        } else if (s_line) {
+            chunk.records.back().line_offset = b - batch;
+            chunk.records.back().line_size = line_end + 1 - b;
+        }
+        b = line_end + 1;
+    }
+}
+
+std::vector<ParsedChunk> ParseBatch(char *data, size_t size, unsigned thread_cnt,
+                                    SequenceMode mode, const char *cov_tag, bool borrow_seq) {
+    assert(size > 0 && data[size - 1] == '\n');
+    const size_t chunk_cnt = std::min(size_t(thread_cnt) * CHUNKS_PER_THREAD, size / MIN_CHUNK_SIZE + 1);
+
+    std::vector<size_t> bounds(1, 0);
+    for (size_t i = 1; i < chunk_cnt; ++i) {
+        size_t pos = std::max(bounds.back(), size * i / chunk_cnt);
+        if (pos >= size)
+            break;
+        const char *nl = utils::tokenizer::FindChar(data + pos, data + size, '\n');
+        assert(nl < data + size);
+        pos = nl - data + 1;
+        if (pos < size && pos > bounds.back())
+            bounds.push_back(pos);
+    }
+    bounds.push_back(size);
+
+    std::vector<ParsedChunk> chunks(bounds.size() - 1);
+    utils::RunInParallel(chunks.size(), thread_cnt, [&](size_t i) {
+        ParseChunk(data, data + bounds[i], data + bounds[i + 1], mode, cov_tag, borrow_seq, chunks[i]);
+    });
+    return chunks;
+}
+
+//Releases data of the segment unless it is in the arena
+void FreeSegmentData(gfa_seg_t &s, const utils::Arena *arena) {
+    if (!arena || !arena->contains(s.seq))
+        free(s.seq);
+    if (!arena || !arena->contains(s.aux.aux))
+        free(s.aux.aux);
+}
+
+//Has to be done sequentially to assign segment ids in order of appearance
+//S-line locations and tag coverage are recorded if lines and coverage are provided
+//Sequences borrowed from the batch text and tags of segments are copied into the arena (if provided)
+size_t AddToGraph(gfa_t *g, std::vector<ParsedChunk> &chunks, uint64_t batch_offset,
+                  SegmentLines *lines, PackedSequences *packed, std::vector<double> *coverage,
+                  utils::Arena *arena) {
+    size_t invalid_cnt = 0;
+    for (auto &chunk : chunks) {
+        invalid_cnt += chunk.invalid_cnt;
+        const uint64_t packed_shift = packed ? packed->Append(chunk.packed) : 0;
+        const char *names = chunk.names.data();
+        for (const Record &r : chunk.records) {
+            if (r.type == 'S') {
+                //gfa_add_seg might reallocate g->seg
+                int32_t sid = gfa_add_seg(g, names + r.name);
+                gfa_seg_t *s = &g->seg[sid];
+                FreeSegmentData(*s, arena);
+                s->len = r.len;
+                s->seq = r.seq;
+                s->aux = r.aux;
+                if (arena) {
+                    MoveName(g, sid, *arena);
+                    if (r.seq)
+                        s->seq = arena->CopyString(r.seq, r.len);
+                    if (r.aux.l_aux) {
+                        s->aux.aux = (uint8_t*) arena->Allocate(r.aux.l_aux);
+                        memcpy(s->aux.aux, r.aux.aux, r.aux.l_aux);
+                        s->aux.m_aux = r.aux.l_aux;
+                    } else {
+                        s->aux = gfa_aux_t();
+                    }
+                    free(r.aux.aux);
+                }
+                if (packed && r.packed_pos != PackedSequences::NONE)
+                    packed->Assign(sid, packed_shift + r.packed_pos, r.len);
+                if (coverage) {
+                    if (coverage->size() <= size_t(sid))
+                        coverage->resize(sid + 1, std::numeric_limits<double>::quiet_NaN());
+                    (*coverage)[sid] = r.cov;
+                }
+                if (lines) {
+                    if (lines->offsets.size() <= size_t(sid)) {
+                        lines->offsets.resize(sid + 1, 0);
+                        lines->sizes.resize(sid + 1, 0);
+                    }
+                    lines->offsets[sid] = batch_offset + r.line_offset;
+                    lines->sizes[sid] = r.line_size;
+                }
+            } else {
+                uint32_t v = uint32_t(gfa_add_seg(g, names + r.name)) << 1 | uint32_t(r.start_rev);
+                uint32_t w = uint32_t(gfa_add_seg(g, names + r.end_name)) << 1 | uint32_t(r.end_rev);
+                gfa_arc_t *arc = gfa_add_arc1(g, v, w, r.ov, r.ow, -1, 0);
+                if (r.aux.l_aux)
+                    g->link_aux[arc->link_id] = r.aux;
+                else
+                    free(r.aux.aux);
+            }
+        }
+        chunk = ParsedChunk();
+    }
+    return invalid_cnt;
+}
+
+//Source of consecutive pieces of GFA text
+class TextSource {
+public:
+    virtual ~TextSource() {}
+
+    //Replaces buffer content with the next piece of text, returns 0 at the end of input
+    virtual size_t Read(TextBuffer *buf) = 0;
+
+    virtual bool failed() const { return false; }
+};
+
+class PlainSource : public TextSource {
+    FILE *f_;
+    const size_t batch_size_;
+
+public:
+    PlainSource(FILE *f, unsigned thread_cnt):
+        f_(f), batch_size_(thread_cnt * BATCH_SIZE_PER_THREAD) {}
+
+    size_t Read(TextBuffer *buf) override {
+        buf->size = 0;
+        buf->reserve(batch_size_);
+        buf->size = fread(buf->data.get(), 1, batch_size_, f_);
+        return buf->size;
+    }
+};
+
+//Reads batches of complete BGZF blocks and decompresses them in parallel
+class BgzfSource : public TextSource {
+    FILE *f_;
+    const unsigned thread_cnt_;
+    TextBuffer compressed_;
+    //already decompressed prefix of compressed_
+    size_t consumed_ = 0;
+    bool failed_ = false;
+
+    //Moves unprocessed tail to the beginning and tops up the buffer, returns false if nothing was read
+    bool Fill() {
+        memmove(compressed_.data.get(), compressed_.data.get() + consumed_, compressed_.size - consumed_);
+        compressed_.size -= consumed_;
+        consumed_ = 0;
+        size_t n = fread(compressed_.data.get() + compressed_.size, 1,
+                         compressed_.capacity - compressed_.size, f_);
+        compressed_.size += n;
+        return n > 0;
+    }
+
+public:
+    BgzfSource(FILE *f, unsigned thread_cnt): f_(f), thread_cnt_(thread_cnt) {
+        compressed_.reserve(std::max(size_t(thread_cnt) * BGZF_BATCH_SIZE_PER_THREAD, 2 * bgzf::MAX_BLOCK_SIZE));
+    }
+
+    size_t Read(TextBuffer *buf) override {
+        buf->size = 0;
+        //batch might consist of empty blocks only
+        while (buf->size == 0 && !failed_) {
+            if (!Fill() && compressed_.size == 0)
+                return 0;
+
+            std::vector<bgzf::BlockInfo> blocks;
+            std::vector<size_t> offsets;
+            size_t pos = 0;
+            bgzf::BlockInfo info;
+            while (pos < compressed_.size) {
+                const size_t avail = compressed_.size - pos;
+                //incomplete block at the end of the buffer is left for the next batch,
+                //buffer fits at least two blocks, so it can only happen at the start if input is truncated
+                bool valid = bgzf::ParseBlock(compressed_.data.get() + pos, avail, info);
+                if (valid && info.size <= avail) {
+                    blocks.push_back(info);
+                    offsets.push_back(pos);
+                    pos += info.size;
+                } else {
+                    failed_ = (pos == 0);
+                    break;
+                }
+            }
+            if (failed_)
+                return 0;
+
+            std::vector<size_t> out_offsets(blocks.size() + 1, 0);
+            for (size_t i = 0; i < blocks.size(); ++i)
+                out_offsets[i + 1] = out_offsets[i] + blocks[i].isize;
+            buf->reserve(out_offsets.back());
+
+            std::atomic<bool> ok(true);
+            utils::RunInParallel(blocks.size(), thread_cnt_, [&](size_t i) {
+                if (!bgzf::InflateBlock(compressed_.data.get() + offsets[i], blocks[i],
+                                        buf->data.get() + out_offsets[i]))
+                    ok = false;
+            });
+            if (!ok) {
+                failed_ = true;
+                return 0;
+            }
+            buf->size = out_offsets.back();
+            consumed_ = pos;
+        }
+        return buf->size;
+    }
+
+    bool failed() const override {
+        return failed_;
+    }
+};
+
+enum class Format {
+    PLAIN,
+    BGZF,
+    //handled by gfa_read
+    OTHER
+};
+
+Format DetectFormat(const std::string &filename) {
+    if (filename == "-")
+        return Format::OTHER;
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return Format::OTHER;
+    unsigned char magic[2] = {0, 0};
+    size_t n = fread(magic, 1, 2, f);
+    fclose(f);
+    //gzip
+    if (n == 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return bgzf::IsBgzfFile(filename) ? Format::BGZF : Format::OTHER;
+    //FASTA
+    if (n > 0 && magic[0] == '>')
+        return Format::OTHER;
+    return Format::PLAIN;
+}
+
+}
+
+gfa_t *ReadParallel(const std::string &filename, unsigned thread_cnt,
+                    SequenceMode mode, SegmentLines *lines, PackedSequences *packed,
+                    const std::string &coverage_tag, std::vector<double> *coverage,
+                    utils::Arena *arena) {
+    assert((mode == SequenceMode::PACKED) == bool(packed));
+    assert(coverage_tag.empty() || coverage);
+    const char *cov_tag = coverage_tag.empty() ? nullptr : coverage_tag.c_str();
+    if (coverage)
+        coverage->clear();
+    const Format format = DetectFormat(filename);
+    if (format == Format::OTHER) {
+        gfa_t *g = gfa_read(filename.c_str());
+        if (g && cov_tag)
+            *coverage = TagCoverage(g, cov_tag);
+        if (g && mode != SequenceMode::RAW) {
+            for (uint32_t i = 0; i < g->n_seg; ++i) {
+                gfa_seg_t &s = g->seg[i];
+                if (s.seq && packed)
+                    packed->Assign(i, packed->Pack(s.seq, s.len), s.len);
+                free(s.seq);
+                s.seq = nullptr;
+            }
+        }
+        return g;
+    }
+
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return nullptr;
+
+    thread_cnt = std::max(thread_cnt, 1u);
+    std::unique_ptr<TextSource> source;
+    if (format == Format::BGZF)
+        source.reset(new BgzfSource(f, thread_cnt));
+    else
+        source.reset(new PlainSource(f, thread_cnt));
+
+    auto read_batch = [&source](TextBuffer *buf) {
+        return source->Read(buf);
+    };
+
+    //offsets are only meaningful for uncompressed input
+    if (format != Format::PLAIN)
+        lines = nullptr;
+    if (lines && !lines->Init(filename))
+        lines = nullptr;
+
+    gfa_t *g = gfa_init();
+    size_t invalid_cnt = 0;
+    //file offset of the text buffer start
+    uint64_t text_offset = 0;
+
+    TextBuffer raw, next_raw, text;
+    //reading (and decompression) of the next batch overlaps with parsing of the current one
+    auto pending = std::async(std::launch::async, read_batch, &next_raw);
+    bool eof = false;
+    while (!eof) {
+        eof = (pending.get() == 0);
+        std::swap(raw, next_raw);
+        if (!eof)
+            pending = std::async(std::launch::async, read_batch, &next_raw);
+
+        //text currently holds unfinished line from the previous batch
+        text.reserve(text.size + raw.size + 1);
+        if (raw.size)
+            memcpy(text.data.get() + text.size, raw.data.get(), raw.size);
+        text.size += raw.size;
+        if (text.size == 0)
+            continue;
+
+        size_t parse_size = text.size;
+        if (eof) {
+            if (text.data[text.size - 1] != '\n')
+                text.data[text.size++] = '\n';
+            parse_size = text.size;
+        } else {
+            const char *b = text.data.get();
+            const char *p = b + text.size;
+            while (p > b && *(p - 1) != '\n')
+                --p;
+            parse_size = p - b;
+        }
+
+        if (parse_size > 0) {
+            auto chunks = ParseBatch(text.data.get(), parse_size, thread_cnt, mode, cov_tag, arena != nullptr);
+            invalid_cnt += AddToGraph(g, chunks, text_offset, lines, packed, cov_tag ? coverage : nullptr, arena);
+        }
+
+        memmove(text.data.get(), text.data.get() + parse_size, text.size - parse_size);
+        text.size -= parse_size;
+        text_offset += parse_size;
+    }
+    fclose(f);
+
+    if (source->failed()) {
+        WARN("Corrupted or truncated BGZF input " << filename);
+        if (arena)
+            DetachArena(g, *arena);
+        gfa_destroy(g);
+        return nullptr;
+    }
+
+    if (invalid_cnt > 0)
+        WARN(invalid_cnt << " invalid S/L-lines were skipped while reading " << filename);
+
+    if (lines) {
+        lines->offsets.resize(g->n_seg, 0);
+        lines->sizes.resize(g->n_seg, 0);
+    }
+    //segments only mentioned in L-lines
+    if (cov_tag)
+        coverage->resize(g->n_seg, std::numeric_limits<double>::quiet_NaN());
+
+    gfa_finalize(g);
+    return g;
+}
+
+namespace {
+
+const size_t MIN_TABLE_CHUNK_SIZE = 1 << 20;
+
+//Resolved values of a line-aligned part of a table
+struct TableChunk {
+    std::vector<std::pair<uint32_t, double>> values;
+    size_t unknown_cnt = 0;
+    //first malformed line
+    const char *error = nullptr;
+};
+
+void ParseTableChunk(const gfa_t *g, const char *b, const char *e, TableChunk &chunk) {
+    using namespace utils::tokenizer;
+    std::string name;
+    while (true) {
+        const char *name_b = SkipSpace(b, e);
+        if (name_b == e)
+            return;
+        const char *name_e = FindSpace(name_b, e);
+        const char *val_b = SkipSpace(name_e, e);
+        const char *val_e = FindSpace(val_b, e);
+        double val;
+        auto res = std::from_chars(val_b, val_e, val);
+        if (val_b == val_e || res.ptr != val_e || res.ec != std::errc()) {
+            chunk.error = name_b;
+            return;
+        }
+        name.assign(name_b, name_e);
+        int32_t id = gfa_name2id(g, name.c_str());
+        if (id < 0)
+            ++chunk.unknown_cnt;
+        else
+            chunk.values.emplace_back(uint32_t(id), val);
+        b = val_e;
+    }
+}
+
+}
+
+bool ReadSegmentValues(const std::string &filename, const gfa_t *g, std::vector<double> &values,
+                       unsigned thread_cnt, double missing_val) {
+    values.assign(g->n_seg, missing_val);
+    auto m = MappedFile::Open(filename);
+    if (!m) {
+        WARN("Failed to read " << filename);
+        return false;
+    }
+    const char *data = m->data();
+    const size_t size = m->size();
+    if (size > 0)
+        madvise((void*) data, size, MADV_SEQUENTIAL);
+
+    thread_cnt = std::max(thread_cnt, 1u);
+    const size_t chunk_cnt = std::min(size_t(thread_cnt) * CHUNKS_PER_THREAD, size / MIN_TABLE_CHUNK_SIZE + 1);
+    std::vector<size_t> bounds(chunk_cnt + 1, size);
+    bounds[0] = 0;
+    for (size_t i = 1; i < chunk_cnt; ++i) {
+        const char *p = utils::tokenizer::FindChar(data + std::max(size * i / chunk_cnt, bounds[i - 1]),
+                                                   data + size, '\n');
+        bounds[i] = std::min(size_t(p - data) + 1, size);
+    }
+
+    std::vector<TableChunk> chunks(chunk_cnt);
+    utils::RunInParallel(chunk_cnt, thread_cnt, [&](size_t i) {
+        ParseTableChunk(g, data + bounds[i], data + bounds[i + 1], chunks[i]);
+    });
+
+    size_t unknown_cnt = 0;
+    for (const auto &chunk : chunks) {
+        for (const auto &id_val : chunk.values)
+            values[id_val.first] = id_val.second;
+        unknown_cnt += chunk.unknown_cnt;
+        if (chunk.error) {
+            const char *line_e = utils::tokenizer::FindChar(chunk.error, data + size, '\n');
+            WARN("Malformed line in " << filename << ": '" << std::string(chunk.error, line_e) << "'");
+            return false;
+        }
+    }
+    if (unknown_cnt > 0)
+        WARN(unknown_cnt << " names from " << filename << " are absent from the graph");
+    return true;
+}
+
+bool PassthroughPossible(const std::string &filename) {
+    return !IsSnapshot(filename) && DetectFormat(filename) == Format::PLAIN;
+}
+
+bool SameFile(const std::string &a, const std::string &b) {
+    struct stat a_st, b_st;
+    return stat(a.c_str(), &a_st) == 0 && stat(b.c_str(), &b_st) == 0 &&
+           a_st.st_dev == b_st.st_dev && a_st.st_ino == b_st.st_ino;
+}
+
+bool SegmentLines::Init(const std::string &fn) {
+    struct stat st;
+    if (stat(fn.c_str(), &st) != 0)
+        return false;
+    filename = fn;
+    file_size = st.st_size;
+    mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    offsets.clear();
+    sizes.clear();
+    return true;
+}
+
+bool SegmentLines::Usable(const gfa_t *g, const std::string &out_fn) const {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0 || uint64_t(st.st_size) != file_size ||
+            int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec != mtime_ns)
+        return false;
+
+    if (SameFile(filename, out_fn))
+        return false;
+
+    if (sizes.size() != g->n_seg)
+        return false;
+    for (uint32_t i = 0; i < g->n_seg; ++i)
+        if (!g->seg[i].del && sizes[i] == 0)
+            return false;
+    return true;
+}
+
+bool WritePassthrough(const gfa_t *g, const SegmentLines &lines, FILE *f) {
+    auto m = MappedFile::Open(lines.filename);
+    if (!m || m->size() != lines.file_size)
+        return false;
+    if (m->size() > 0)
+        madvise((void*) m->data(), m->size(), MADV_SEQUENTIAL);
+
+    //consecutive lines are copied at once
+    uint64_t run_start = 0, run_end = 0;
+    auto flush = [&]() {
+        if (run_end > run_start)
+            fwrite(m->data() + run_start, 1, run_end - run_start, f);
+    };
+    for (uint32_t i = 0; i < g->n_seg; ++i) {
+        if (g->seg[i].del)
+            continue;
+        //last line of the file might lack '\n'
+        uint64_t b = lines.offsets[i];
+        uint64_t e = std::min(b + lines.sizes[i], m->size());
+        if (b != run_end) {
+            flush();
+            run_start = b;
+        }
+        run_end = e;
+        if (m->data()[e - 1] != '\n') {
+            flush();
+            fputc('\n', f);
+            run_start = run_end;
+        }
+    }
+    flush();
+
+    //shallow copy without segments, so that only links are printed
+    gfa_t links_only = *g;
+    links_only.n_seg = 0;
+    gfa_print(&links_only, f, 0);
+    return true;
+}
+
+namespace {
+
+//Adapts compressing buffer to FILE* interface used by gfa_print
+ssize_t CookieWrite(void *cookie, const char *buf, size_t size) {
+    auto *sb = (bgzf::CompressingStreamBuf*) cookie;
+    return sb->sputn(buf, size) == std::streamsize(size) ? ssize_t(size) : -1;
+}
+
+int CookieClose(void *cookie) {
+    auto *sb = (bgzf::CompressingStreamBuf*) cookie;
+    bool ok = sb->Close();
+    delete sb;
+    return ok ? 0 : EOF;
+}
+
+//Owns the compressing buffer
+class CompressedOStream : public std::ostream {
+    std::unique_ptr<bgzf::CompressingStreamBuf> sb_;
+
+public:
+    explicit CompressedOStream(bgzf::CompressingStreamBuf *sb): std::ostream(sb), sb_(sb) {}
+
+    ~CompressedOStream() {
+        sb_->Close();
+    }
+
+    bool Close() {
+        return sb_->Close() && !fail();
+    }
+};
+
+}
+
+bool CompressedOutput(const std::string &filename, bool compress) {
+    const std::string ext = ".gz";
+    return compress || (filename.size() > ext.size() &&
+                        filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0);
+}
+
+FILE *OpenOutputFile(const std::string &filename, bool compress, unsigned thread_cnt) {
+    FILE *f = fopen(filename.c_str(), "w");
+    if (!f || !compress)
+        return f;
+    cookie_io_functions_t funcs = {nullptr, CookieWrite, nullptr, CookieClose};
+    auto *sb = new bgzf::CompressingStreamBuf(f, thread_cnt);
+    FILE *cf = fopencookie(sb, "w", funcs);
+    if (!cf) {
+        delete sb;
+        return nullptr;
+    }
+    setvbuf(cf, nullptr, _IOFBF, 1 << 20);
+    return cf;
+}
+
+std::unique_ptr<std::ostream> OpenOutputStream(const std::string &filename,
+                                               bool compress, unsigned thread_cnt) {
+    if (!compress)
+        return std::unique_ptr<std::ostream>(new std::ofstream(filename));
+    FILE *f = fopen(filename.c_str(), "w");
+    if (!f)
+        return std::unique_ptr<std::ostream>(new std::ofstream(filename));
+    return std::unique_ptr<std::ostream>(new CompressedOStream(new bgzf::CompressingStreamBuf(f, thread_cnt)));
+}
+
+bool CloseOutputStream(std::ostream &out) {
+    if (auto *compressed = dynamic_cast<CompressedOStream*>(&out))
+        return compressed->Close();
+    auto &file = dynamic_cast<std::ofstream&>(out);
+    if (!file.is_open())
+        return false;
+    file.close();
+    return !file.fail();
+}
+
+}
+}
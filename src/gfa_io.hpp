@@ -0,0 +1,108 @@
+#pragma once
+
+#include "gfa.h"
+#include "arena.hpp"
+#include "packed_sequence.hpp"
+
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gfa {
+namespace io {
+
+//Locations of S-lines in the uncompressed GFA file the graph was loaded from
+struct SegmentLines {
+    std::string filename;
+    //used to detect modification of the file after loading
+    uint64_t file_size = 0;
+    int64_t mtime_ns = 0;
+    //indexed by segment id, lines include '\n', size is 0 if segment had no S-line
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> sizes;
+
+    //Remembers the file state
+    bool Init(const std::string &fn);
+
+    //Lines can be copied to out_fn if every remaining segment has one,
+    //source file is unchanged and is not going to be overwritten
+    bool Usable(const gfa_t *g, const std::string &out_fn) const;
+};
+
+//Multithreaded counterpart of gfa_read for uncompressed or BGZF-compressed GFA files.
+//Input is processed in large batches, each split into line-aligned chunks,
+//S/L records of the chunks are parsed in parallel and then added to the graph
+//in file order, so resulting gfa_t (segment ids, name hash, arc index) is the same.
+//Lines are split with the vectorized tokenizer, so it is faster even for a single thread.
+//BGZF blocks are decompressed in parallel while the previous batch is being parsed.
+//Falls back to gfa_read for stdin, plain gzipped or FASTA input.
+//In SKIP mode segment sequences are not kept (dropped after gfa_read in case of fallback),
+//in PACKED mode they are packed into the provided store instead of gfa_seg_t::seq.
+//S-line locations are recorded into lines (if provided) for uncompressed input only.
+//If coverage_tag is not empty, its values are decoded into coverage (see TagCoverage) while parsing.
+//If arena is provided, segment names, sequences and tags are placed there instead of individual
+//allocations, so they have to be detached before gfa_destroy (see Graph::Reset).
+gfa_t *ReadParallel(const std::string &filename, unsigned thread_cnt,
+                    SequenceMode mode = SequenceMode::RAW, SegmentLines *lines = nullptr,
+                    PackedSequences *packed = nullptr,
+                    const std::string &coverage_tag = "", std::vector<double> *coverage = nullptr,
+                    utils::Arena *arena = nullptr);
+
+//Nulls out segment names, sequences and tags placed in the arena, so that gfa_destroy doesn't free them
+void DetachArena(gfa_t *g, const utils::Arena &arena);
+
+//Replaces the name copy made by gfa_add_seg with the one in the arena (also used as the hash key)
+void MoveName(gfa_t *g, uint32_t sid, utils::Arena &arena);
+
+//Preallocates segment, arc and name hash storage, so that gfa_add_seg and gfa_add_arc1 don't have to grow it
+void Reserve(gfa_t *g, uint32_t segment_cnt, uint64_t arc_cnt);
+
+//Tags holding total k-mer (KC) or base (RC) counts rather than average coverage (ll, dp, etc.)
+bool CountCoverageTag(const std::string &tag);
+
+//Numeric value of the segment tag, counts are divided by segment length. NaN if tag is absent.
+double TagCoverage(const gfa_aux_t &aux, const char *tag, uint32_t len);
+
+//Same for every segment of the graph
+std::vector<double> TagCoverage(const gfa_t *g, const char *tag);
+
+//Input can be loaded with S-line locations recorded
+bool PassthroughPossible(const std::string &filename);
+
+//Both names refer to the same existing file (same device and inode)
+bool SameFile(const std::string &a, const std::string &b);
+
+//Writes S-lines of the remaining segments by copying them from the source file
+//(so sequences don't have to be loaded), followed by links printed with gfa_print.
+//Returns false without writing anything if the source can't be mapped.
+bool WritePassthrough(const gfa_t *g, const SegmentLines &lines, FILE *f);
+
+//Reads '<segment name> <value>' lines (coverage, read counts) into a vector indexed by segment id.
+//File is memory-mapped and split into line-aligned chunks parsed on thread_cnt threads,
+//every name is resolved against the graph once. Unknown names are skipped with a warning,
+//segments absent from the file get missing_val, later lines win for repeated names.
+//Returns false if the file can't be read or contains a malformed line.
+bool ReadSegmentValues(const std::string &filename, const gfa_t *g, std::vector<double> &values,
+                       unsigned thread_cnt = 1,
+                       double missing_val = std::numeric_limits<double>::quiet_NaN());
+
+//Compressed output is used if requested or if filename ends with .gz
+bool CompressedOutput(const std::string &filename, bool compress);
+
+//Opens file for writing, BGZF-compressing it on thread_cnt threads if requested.
+//Has to be closed with fclose. Returns nullptr on failure.
+FILE *OpenOutputFile(const std::string &filename, bool compress = false, unsigned thread_cnt = 1);
+
+//Same as OpenOutputFile, but provides an output stream
+std::unique_ptr<std::ostream> OpenOutputStream(const std::string &filename,
+                                               bool compress = false, unsigned thread_cnt = 1);
+
+//Finishes the stream provided by OpenOutputStream (compressed output gets its EOF marker)
+//and closes the file. Returns false if anything failed to be written
+bool CloseOutputStream(std::ostream &out);
+
+}
+}
@@ -0,0 +1,94 @@
+#include "graph_builder.hpp"
+#include "gfa-priv.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace gfa {
+
+GraphBuilder::GraphBuilder(SequenceMode mode, bool arena_storage):
+        g_ptr_(nullptr, gfa_destroy), mode_(mode), arena_storage_(arena_storage) {
+    Reset();
+}
+
+GraphBuilder::~GraphBuilder() {
+    if (g_ptr_ && arena_)
+        io::DetachArena(g_ptr_.get(), *arena_);
+}
+
+void GraphBuilder::Reset() {
+    if (g_ptr_ && arena_)
+        io::DetachArena(g_ptr_.get(), *arena_);
+    g_ptr_.reset(gfa_init());
+    arena_.reset(arena_storage_ ? new utils::Arena() : nullptr);
+    packed_.reset(mode_ == SequenceMode::PACKED ? new PackedSequences() : nullptr);
+    coverage_.clear();
+    has_coverage_ = false;
+}
+
+void GraphBuilder::Reserve(SegmentId segment_cnt, size_t link_cnt) {
+    //room for the duals added by Build
+    io::Reserve(g_ptr_.get(), uint32_t(segment_cnt), 2 * uint64_t(link_cnt));
+    coverage_.reserve(segment_cnt);
+}
+
+SegmentId GraphBuilder::AddName(std::string_view name) {
+    gfa_t *g = g_ptr_.get();
+    name_buf_.assign(name);
+    const uint32_t n_seg = g->n_seg;
+    const int32_t sid = gfa_add_seg(g, name_buf_.c_str());
+    if (g->n_seg > n_seg) {
+        if (arena_)
+            io::MoveName(g, sid, *arena_);
+        coverage_.push_back(NO_COVERAGE);
+    }
+    return SegmentId(sid);
+}
+
+SegmentId GraphBuilder::SetSegment(std::string_view name, const char *seq, SegmentLength length, double coverage) {
+    const SegmentId sid = AddName(name);
+    gfa_seg_t &s = g_ptr_->seg[sid];
+    if (!arena_ || !arena_->contains(s.seq))
+        free(s.seq);
+    s.seq = nullptr;
+    s.len = int32_t(length);
+    if (seq) {
+        switch (mode_) {
+            case SequenceMode::SKIP:
+                break;
+            case SequenceMode::RAW:
+                if (arena_) {
+                    s.seq = arena_->CopyString(seq, length);
+                } else {
+                    s.seq = (char*) malloc(length + 1);
+                    memcpy(s.seq, seq, length);
+                    s.seq[length] = '\0';
+                }
+                break;
+            case SequenceMode::PACKED:
+                packed_->Assign(uint32_t(sid), packed_->Pack(seq, length), uint32_t(length));
+                break;
+        }
+    }
+    coverage_[sid] = coverage;
+    has_coverage_ |= !std::isnan(coverage);
+    return sid;
+}
+
+void GraphBuilder::AddLink(DirectedSegment v, DirectedSegment w, int32_t start_overlap, int32_t end_overlap) {
+    assert(v.segment_id < segment_cnt() && w.segment_id < segment_cnt());
+    gfa_add_arc1(g_ptr_.get(), uint32_t(v.AsInnerVertexT()), uint32_t(w.AsInnerVertexT()),
+                 start_overlap, end_overlap, -1, 0);
+}
+
+void GraphBuilder::Build(Graph &g) {
+    gfa_finalize(g_ptr_.get());
+    g.Reset(g_ptr_.release(), nullptr, std::move(arena_));
+    g.packed_ = std::move(packed_);
+    if (has_coverage_)
+        g.coverage_ = std::move(coverage_);
+    Reset();
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "wrapper.hpp"
+#include "arena.hpp"
+#include "packed_sequence.hpp"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gfa {
+
+//Constructs a Graph in memory without going through GFA text.
+//Segments and links are only appended (the way the GFA loader does for S and L-lines),
+//arcs are sorted and indexed once in Build, so the result is the same as loading
+//a file with the same records in the same order (segment ids are assigned in order of first mention).
+//Sequences are kept according to the sequence mode, names and sequences go to the arena unless disabled
+class GraphBuilder {
+    std::unique_ptr<gfa_t, void(*)(gfa_t*)> g_ptr_;
+    SequenceMode mode_;
+    bool arena_storage_;
+    std::unique_ptr<utils::Arena> arena_;
+    std::unique_ptr<PackedSequences> packed_;
+    //NaN for segments without provided coverage
+    std::vector<double> coverage_;
+    bool has_coverage_ = false;
+    //null-terminated copy of the name for the gfatools hash
+    std::string name_buf_;
+
+    //seq is null if absent
+    SegmentId SetSegment(std::string_view name, const char *seq, SegmentLength length, double coverage);
+
+    //detaches arena storage before destroying the current graph
+    void Reset();
+
+public:
+    static constexpr double NO_COVERAGE = std::numeric_limits<double>::quiet_NaN();
+
+    explicit GraphBuilder(SequenceMode mode = SequenceMode::RAW, bool arena_storage = true);
+
+    GraphBuilder(const GraphBuilder&) = delete;
+    GraphBuilder& operator=(const GraphBuilder&) = delete;
+
+    ~GraphBuilder();
+
+    //Preallocates storage for the expected numbers of segments and links
+    void Reserve(SegmentId segment_cnt, size_t link_cnt);
+
+    //Id of the segment with given name, added without sequence and length if it wasn't mentioned yet.
+    //Segments that are only mentioned (e.g. by links) are marked as removed by Build, same as in the loader
+    SegmentId AddName(std::string_view name);
+
+    //Empty sequence is treated as absent ('*'), repeated names replace the previous record
+    SegmentId AddSegment(std::string_view name, std::string_view sequence, double coverage = NO_COVERAGE) {
+        return SetSegment(name, sequence.empty() ? nullptr : sequence.data(), sequence.size(), coverage);
+    }
+
+    //Segment without sequence (S-line with '*' and LN tag)
+    SegmentId AddSegmentWithLength(std::string_view name, SegmentLength length, double coverage = NO_COVERAGE) {
+        return SetSegment(name, nullptr, length, coverage);
+    }
+
+    //Both ends have to be added first, the dual arc is added by Build unless provided explicitly
+    void AddLink(DirectedSegment v, DirectedSegment w, int32_t start_overlap, int32_t end_overlap);
+
+    void AddLink(DirectedSegment v, DirectedSegment w, int32_t overlap) {
+        AddLink(v, w, overlap, overlap);
+    }
+
+    SegmentId segment_cnt() const { return g_ptr_->n_seg; }
+
+    //Number of links added so far (without the duals)
+    size_t link_cnt() const { return g_ptr_->n_arc; }
+
+    //Sorts and indexes the arcs, adds the missing duals and moves the result into g.
+    //Builder is empty afterwards and can be reused
+    void Build(Graph &g);
+};
+
+}
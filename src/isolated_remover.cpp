@@ -25,8 +25,8 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
     }
 
     if (cfg.cov_thr >= 0.) {
-        if (cfg.coverage.empty()) {
-            std::cerr << "Provide --coverage file\n";
+        if (!cfg.has_coverage()) {
+            std::cerr << "Provide --coverage file or --coverage-tag\n";
             exit(2);
         }
     }
@@ -36,39 +36,34 @@ int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     size_t ndel = 0;
+    //removing isolated segments doesn't affect the others
+    gfa::DeletionBatch batch(g);
     std::cout << "Isolated segments shorter than " << cfg.max_length << "bp will be removed" << std::endl;
 
     if (cfg.cov_thr >= 0.)
         std::cout << "Only segments with coverage below " << cfg.cov_thr << " will be considered" << std::endl;
 
-    for (gfa::DirectedSegment ds : g.directed_segments()) {
-        if (ds.direction == gfa::Direction::REVERSE)
-            continue;
+    auto to_remove = utils::ParallelFilter(g.forward_segments(), cfg.threads, [&](gfa::DirectedSegment ds) {
+        return g.incoming_link_cnt(ds) + g.outgoing_link_cnt(ds) == 0 &&
+                g.segment_length(ds) < cfg.max_length &&
+                (cfg.cov_thr < 0. || g.coverage(ds) < cfg.cov_thr);
+    });
 
-        if (g.incoming_link_cnt(ds) + g.outgoing_link_cnt(ds) == 0 &&
-                g.segment_length(ds) < cfg.max_length) {
-            if (cfg.cov_thr >= 0. && utils::get(*segment_cov_ptr, g.segment_name(ds)) >= cfg.cov_thr) {
-                DEBUG("Coverage of segment " << g.str(ds) << " exceeded upper bound");
-            } else {
-                INFO("Will remove node " << g.str(ds));
-                g.DeleteSegment(ds);
-                ndel++;
-            }
-        }
+    for (gfa::DirectedSegment ds : to_remove) {
+        INFO("Will remove node " << g.str(ds));
+        batch.DeleteSegment(ds);
+        ndel++;
     }
+    g.Apply(batch);
 
-    tooling::OutputGraph(g, cfg, ndel, segment_cov_ptr.get());
+    tooling::OutputGraph(g, cfg, ndel);
     std::cout << "END" << std::endl;
 }
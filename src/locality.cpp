@@ -0,0 +1,84 @@
+#include "locality.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace gfa {
+
+bool ParseSegmentOrder(const std::string &s, SegmentOrder &order) {
+    if (s == "input")
+        order = SegmentOrder::INPUT;
+    else if (s == "bfs")
+        order = SegmentOrder::BFS;
+    else if (s == "rcm")
+        order = SegmentOrder::RCM;
+    else
+        return false;
+    return true;
+}
+
+namespace {
+
+//Calls f(t) for segments t linked to segment s (with repeats)
+template<class F>
+void ForEachNeighbor(const gfa_t *g, uint32_t s, F f) {
+    for (uint32_t v : {s << 1, s << 1 | 1}) {
+        const gfa_arc_t *av = gfa_arc_a(g, v);
+        for (uint32_t i = 0, nv = gfa_arc_n(g, v); i < nv; ++i)
+            if (!av[i].del)
+                f(av[i].w >> 1);
+    }
+}
+
+}
+
+std::vector<uint32_t> LocalityOrder(const gfa_t *g, SegmentOrder method) {
+    const uint32_t n = g->n_seg;
+    std::vector<uint32_t> order;
+    order.reserve(n);
+    if (method == SegmentOrder::INPUT) {
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0);
+        return order;
+    }
+
+    std::vector<uint32_t> degree;
+    std::vector<uint32_t> starts(n);
+    std::iota(starts.begin(), starts.end(), 0);
+    if (method == SegmentOrder::RCM) {
+        degree.assign(n, 0);
+        for (uint32_t s = 0; s < n; ++s)
+            ForEachNeighbor(g, s, [&](uint32_t) { ++degree[s]; });
+        std::stable_sort(starts.begin(), starts.end(),
+                         [&](uint32_t a, uint32_t b) { return degree[a] < degree[b]; });
+    }
+
+    //order doubles as the BFS queue
+    std::vector<bool> visited(n, false);
+    for (uint32_t start : starts) {
+        if (visited[start])
+            continue;
+        visited[start] = true;
+        order.push_back(start);
+        for (size_t head = order.size() - 1; head < order.size(); ++head) {
+            const size_t first_new = order.size();
+            ForEachNeighbor(g, order[head], [&](uint32_t t) {
+                if (!visited[t]) {
+                    visited[t] = true;
+                    order.push_back(t);
+                }
+            });
+            if (method == SegmentOrder::RCM)
+                std::stable_sort(order.begin() + first_new, order.end(),
+                                 [&](uint32_t a, uint32_t b) { return degree[a] < degree[b]; });
+        }
+    }
+    assert(order.size() == n);
+
+    if (method == SegmentOrder::RCM)
+        std::reverse(order.begin(), order.end());
+    return order;
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "gfa.h"
+
+#include <string>
+#include <vector>
+
+namespace gfa {
+
+//Numbering of segments
+enum class SegmentOrder {
+    //as in the input file
+    INPUT,
+    //breadth-first search over the links (ignoring their directions) started from the segments in input order
+    BFS,
+    //reverse Cuthill-McKee: BFS from minimal degree segments visiting neighbors in order of increasing degree,
+    //reversed in the end
+    RCM
+};
+
+//Accepts 'input', 'bfs' or 'rcm'
+bool ParseSegmentOrder(const std::string &s, SegmentOrder &order);
+
+//Returns segment ids listed in the new order, every segment of the graph (including deleted ones) is listed once.
+//Consecutive ids of linked segments make traversals much more cache-friendly
+std::vector<uint32_t> LocalityOrder(const gfa_t *g, SegmentOrder method);
+
+}
@@ -17,7 +17,7 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 
 
     auto result = parse(argc, argv, cli);
-    assert(!cfg.coverage.empty());
+    assert(cfg.has_coverage());
     if (!result) {
         std::cerr << "Loop link will be killed if coverage of the node doesn't exceed 'max_base_coverage' and other links are present" << std::endl;
         std::cerr << make_man_page(cli, argv[0]);
@@ -26,28 +26,26 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 }
 
 //TODO consider making iterative right here after I can compress and track reads here
-//TODO put coverage into GFA (check support in parser, etc)
 int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
     std::cout << "Max base segment coverage set to " << cfg.max_base_coverage << std::endl;
 
-    std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-    const auto segment_cov = utils::ReadCoverage(cfg.coverage);
 
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     //std::set<std::string> neighbourhood;
 
     size_t l_ndel = 0;
-    for (gfa::DirectedSegment v : g.directed_segments()) {
-        //TODO add forward-only iterator
-        if (v.direction == gfa::Direction::REVERSE)
-            continue;
+    //loops only affect the link counts of their own segment
+    gfa::DeletionBatch batch(g);
+    for (gfa::DirectedSegment v : g.forward_segments()) {
         if (g.outgoing_link_cnt(v) < 2 || g.incoming_link_cnt(v) < 2)
             continue;
 
@@ -56,14 +54,15 @@ int main(int argc, char *argv[]) {
             assert(l.start == v);
             if (l.end != v)
                 continue;
-            if (utils::get(segment_cov, g.segment_name(v)) <= cfg.max_base_coverage) {
+            if (g.coverage(v) <= cfg.max_base_coverage) {
                 std::cout << "Removing loop link from segment " << g.str(v) << '\n';
-                g.DeleteLink(l);
+                batch.DeleteLink(l);
                 ++l_ndel;
             }
         }
     }
+    g.Apply(batch);
 
-    tooling::OutputGraph(g, cfg, l_ndel, &segment_cov);
+    tooling::OutputGraph(g, cfg, l_ndel);
     std::cout << "END" << std::endl;
 }
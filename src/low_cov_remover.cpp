@@ -20,7 +20,7 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 
 
     auto result = parse(argc, argv, cli);
-    assert(!cfg.coverage.empty());
+    assert(cfg.has_coverage());
     if (!result) {
         std::cerr << "Removing nodes shorter than max-length with coverage below cov-thr" << std::endl;
         std::cerr << make_man_page(cli, argv[0]);
@@ -32,33 +32,32 @@ int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
-    std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-    const auto segment_cov = utils::ReadCoverage(cfg.coverage);
 
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     size_t ndel = 0;
+    //decisions don't depend on each other
+    gfa::DeletionBatch batch(g);
 
     std::cout << "Nodes with coverage below " << cfg.cov_thr <<
             " no longer than " << cfg.max_length << "bp will be removed" << std::endl;
 
-    for (gfa::DirectedSegment ds : g.directed_segments()) {
-        //DEBUG("Processing segment " << g.str(ds) << " of length " << g.segment_length(ds));
-        if (ds.direction == gfa::Direction::REVERSE || g.segment_length(ds) > cfg.max_length)
-            continue;
+    auto to_remove = utils::ParallelFilter(g.forward_segments(), cfg.threads, [&](gfa::DirectedSegment ds) {
+        return g.segment_length(ds) <= cfg.max_length && g.coverage(ds) < cfg.cov_thr;
+    });
 
-        double cov = utils::get(segment_cov, g.segment_name(ds));
-        //DEBUG("Segment " << g.str(ds) << " with coverage " << cov);
-        if (cov < cfg.cov_thr) {
-            INFO("Will remove node " << g.str(ds) << " of length " << g.segment_length(ds) << " with coverage " << cov);
-            g.DeleteSegment(ds);
-            ndel++;
-        }
+    for (gfa::DirectedSegment ds : to_remove) {
+        INFO("Will remove node " << g.str(ds) << " of length " << g.segment_length(ds) << " with coverage " << g.coverage(ds));
+        batch.DeleteSegment(ds);
+        ndel++;
     }
+    g.Apply(batch);
 
-    tooling::OutputGraph(g, cfg, ndel, &segment_cov);
+    tooling::OutputGraph(g, cfg, ndel);
     std::cout << "END" << std::endl;
 }
@@ -4,7 +4,6 @@
 #include <functional>
 #include <memory>
 #include <algorithm>
-#include <set>
 #include <cassert>
 #include <iostream>
 
@@ -44,8 +43,8 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
   }
 
   if (cfg.max_unique_cov > -1. || cfg.reliable_cov > -1.) {
-      if (cfg.coverage.empty()) {
-          std::cerr << "Provide --coverage file" << std::endl;
+      if (!cfg.has_coverage()) {
+          std::cerr << "Provide --coverage file or --coverage-tag" << std::endl;
           exit(2);
       }
   }
@@ -55,10 +54,10 @@ typedef std::function<bool (gfa::SegmentId)> UniquenessF;
 
 //If a unique node has two unambiguously incoming then those are marked suspicious (the ones shorter than nonsuspicious_length)
 //TODO maybe check for reliable coverage
-inline std::set<gfa::SegmentId> FindSuspicious(const gfa::Graph &g,
+inline utils::DenseSet<gfa::SegmentId> FindSuspicious(const gfa::Graph &g,
                                           UniquenessF uniqueness_f,
-                                          std::set<gfa::SegmentId> &suspected_false) {
-   std::set<gfa::SegmentId> suspected_repeats;
+                                          utils::DenseSet<gfa::SegmentId> &suspected_false) {
+   utils::DenseSet<gfa::SegmentId> suspected_repeats(g.segment_cnt());
     for (auto w: g.directed_segments()) {
         if (!uniqueness_f(w.segment_id))
             continue;
@@ -80,8 +79,8 @@ inline std::set<gfa::SegmentId> FindSuspicious(const gfa::Graph &g,
     return suspected_repeats;
 }
 
-inline std::set<gfa::SegmentId> FindDeadends(const gfa::Graph &g) {
-    std::set<gfa::SegmentId> answer;
+inline utils::DenseSet<gfa::SegmentId> FindDeadends(const gfa::Graph &g) {
+    utils::DenseSet<gfa::SegmentId> answer(g.segment_cnt());
     for (auto v: g.directed_segments()) {
         if (g.no_outgoing(v)) {
             answer.insert(v.segment_id);
@@ -94,32 +93,27 @@ int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     auto initial_deadends = FindDeadends(g);
 
     auto cov_f = [&](gfa::SegmentId s) {
-        assert(segment_cov_ptr);
-        return double(utils::get(*segment_cov_ptr, g.segment_name(s)));
+        return g.coverage(s);
     };
 
     //Segments for which coverage is not enough to be considered unique
-    std::set<gfa::SegmentId> suspected_repeats;
+    utils::DenseSet<gfa::SegmentId> suspected_repeats(g.segment_cnt());
     //Segments for which coverage is not enough to be considered reliable
-    std::set<gfa::SegmentId> suspected_false;
+    utils::DenseSet<gfa::SegmentId> suspected_false(g.segment_cnt());
     auto uniqueness_f = [&](gfa::SegmentId s) {
         if (g.segment_length(s) > cfg.unique_len)
             return true;
-        if (segment_cov_ptr && !suspected_repeats.count(s))
+        if (g.has_coverage() && !suspected_repeats.count(s))
             if (cov_f(s) < cfg.max_unique_cov + 1e-5)
                 return true;
         return false;
@@ -136,7 +130,7 @@ int main(int argc, char *argv[]) {
         if (g.segment_length(w) >= cfg.reliable_len) {
             return true;
         }
-        if (segment_cov_ptr && !suspected_false.count(w.segment_id))
+        if (g.has_coverage() && !suspected_false.count(w.segment_id))
             if (cov_f(w.segment_id) > cfg.reliable_cov - 1e-5)
                 return true;
         return false;
@@ -209,10 +203,11 @@ int main(int argc, char *argv[]) {
     //    }
     //}
 
-    tooling::OutputGraph(g, cfg, l_ndel, segment_cov_ptr.get());
+    tooling::OutputGraph(g, cfg, l_ndel);
 
-    for (auto s_id: FindDeadends(g)) {
-        if (initial_deadends.count(s_id) == 0) {
+    const auto final_deadends = FindDeadends(g);
+    for (gfa::SegmentId s_id = 0; s_id < g.segment_cnt(); ++s_id) {
+        if (final_deadends.count(s_id) && initial_deadends.count(s_id) == 0) {
             WARN("New deadend was formed! Node: " << g.str(s_id));
         }
     }
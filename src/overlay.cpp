@@ -0,0 +1,80 @@
+#include "overlay.hpp"
+
+namespace gfa {
+
+GraphOverlay::GraphOverlay(const Graph &g):
+        g_(g), dual_arcs_(std::make_shared<const std::vector<uint64_t>>(g.DualArcIndex())),
+        deleted_segments_(g.segment_cnt()), deleted_arcs_(g.link_cnt()) {
+    Reset();
+}
+
+void GraphOverlay::Reset() {
+    deleted_segments_.clear();
+    deleted_arcs_.clear();
+    live_degree_.resize(gfa_n_vtx(g_.get()));
+    for (InnerVertexId inner_v = 0; inner_v < live_degree_.size(); ++inner_v)
+        live_degree_[inner_v] = g_.outgoing_link_cnt(DirectedSegment::FromInnerVertexT(inner_v));
+}
+
+void GraphOverlay::DeleteArc(uint64_t k) {
+    const gfa_arc_t *arcs = g_.get()->arc;
+    for (uint64_t i : {k, (*dual_arcs_)[k]}) {
+        if (!arcs[i].del && deleted_arcs_.insert(i))
+            --live_degree_[arcs[i].v_lv >> 32];
+    }
+}
+
+void GraphOverlay::DeleteLink(const LinkInfo &l) {
+    if (l.arc_id() == LinkInfo::NO_ARC) {
+        DeleteLink(l.start, l.end);
+        return;
+    }
+    assert(l.arc_id() < g_.link_cnt());
+    DeleteArc(l.arc_id());
+}
+
+void GraphOverlay::DeleteLink(DirectedSegment v, DirectedSegment w) {
+    const gfa_t *g = g_.get();
+    const uint64_t start = gfa_arc_a(g, v.AsInnerVertexT()) - g->arc;
+    for (uint64_t k = start; k < start + gfa_arc_n(g, v.AsInnerVertexT()); ++k)
+        if (g->arc[k].w == w.AsInnerVertexT())
+            DeleteArc(k);
+}
+
+void GraphOverlay::DeleteSegment(SegmentId segment_id) {
+    deleted_segments_.insert(segment_id);
+    const gfa_t *g = g_.get();
+    for (InnerVertexId inner_v : {InnerVertexId(segment_id) << 1, InnerVertexId(segment_id) << 1 | 1}) {
+        const uint64_t start = gfa_arc_a(g, inner_v) - g->arc;
+        for (uint64_t k = start; k < start + gfa_arc_n(g, inner_v); ++k)
+            DeleteArc(k);
+    }
+}
+
+DeletionBatch GraphOverlay::ToBatch() const {
+    DeletionBatch batch(g_);
+    for (SegmentId s = 0; s < g_.segment_cnt(); ++s)
+        if (deleted_segments_.count(s))
+            batch.DeleteSegment(s);
+    const gfa_arc_t *arcs = g_.get()->arc;
+    for (uint64_t k = 0; k < g_.link_cnt(); ++k)
+        if (deleted_arcs_.count(k))
+            batch.DeleteLink(LinkInfo::FromInnerArcT(arcs[k], k));
+    return batch;
+}
+
+SegmentId GraphOverlay::live_segment_cnt() const {
+    SegmentId answer = 0;
+    for (SegmentId s = 0; s < g_.segment_cnt(); ++s)
+        answer += !removed(s);
+    return answer;
+}
+
+size_t GraphOverlay::live_arc_cnt() const {
+    size_t answer = 0;
+    for (uint32_t degree : live_degree_)
+        answer += degree;
+    return answer;
+}
+
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "wrapper.hpp"
+#include "utils.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace gfa {
+
+//Skips links of the arcs deleted in the overlay (on top of the ones deleted in the base graph)
+class OverlayLinkIterator {
+    LinkIterator it_;
+    LinkIterator end_;
+    const utils::DenseSet<uint64_t> *deleted_arcs_;
+
+    void SkipDeleted() {
+        while (it_ != end_ && deleted_arcs_->count((*it_).arc_id()))
+            ++it_;
+    }
+
+public:
+    OverlayLinkIterator(LinkIterator it, LinkIterator end, const utils::DenseSet<uint64_t> *deleted_arcs) :
+        it_(it), end_(end), deleted_arcs_(deleted_arcs) {
+        SkipDeleted();
+    }
+
+    OverlayLinkIterator& operator++() {
+        ++it_;
+        SkipDeleted();
+        return *this;
+    }
+
+    OverlayLinkIterator operator++(int) {
+        auto retval = *this;
+        ++(*this);
+        return retval;
+    }
+
+    bool operator==(const OverlayLinkIterator &other) const {
+        return it_ == other.it_;
+    }
+
+    bool operator!=(const OverlayLinkIterator &other) const {
+        return !(*this == other);
+    }
+
+    LinkInfo operator*() const {
+        return *it_;
+    }
+
+    // iterator traits
+    using difference_type = ptrdiff_t;
+    using value_type = LinkInfo;
+    using pointer = const LinkInfo*;
+    using reference = const LinkInfo&;
+    using iterator_category = std::forward_iterator_tag;
+};
+
+//Copy-on-write view of a Graph for tentative edits: deletions are recorded in bitsets and
+//link counts of the overlay, the base graph is not modified.
+//Offers the query and deletion API of Graph, so that several variants of a procedure
+//can be evaluated against a single loaded graph (see ToBatch to apply the chosen one).
+//Takes 4 bytes per directed segment plus a bit per segment and per arc (and the dual arc index shared by the copies),
+//invalidated by modifications of the base graph
+class GraphOverlay {
+    const Graph &g_;
+    //built once per base graph, so that deletions don't search for the duals
+    std::shared_ptr<const std::vector<uint64_t>> dual_arcs_;
+    utils::DenseSet<SegmentId> deleted_segments_;
+    //both arcs of every deleted link
+    utils::DenseSet<uint64_t> deleted_arcs_;
+    //number of non-deleted outgoing arcs, indexed by inner vertex id
+    std::vector<uint32_t> live_degree_;
+
+    //Marks arc with index k and its dual as deleted
+    void DeleteArc(uint64_t k);
+
+public:
+    explicit GraphOverlay(const Graph &g);
+
+    //Copies continue from the edits made so far (over the same base graph)
+    GraphOverlay(const GraphOverlay&) = default;
+
+    const Graph &base() const { return g_; }
+
+    //Discards all edits of the overlay
+    void Reset();
+
+    //Marks segment and all its links as deleted
+    void DeleteSegment(SegmentId segment_id);
+
+    void DeleteSegment(DirectedSegment v) { DeleteSegment(v.segment_id); }
+
+    //Constant time if the link came from one of the iterators (see LinkInfo::arc_id)
+    void DeleteLink(const LinkInfo &l);
+
+    //Marks all arcs from v to w and their duals, searches through outgoing arcs of v
+    void DeleteLink(DirectedSegment v, DirectedSegment w);
+
+    //Deletions of the overlay to be applied to the base graph (see Graph::Apply)
+    DeletionBatch ToBatch() const;
+
+    bool removed(SegmentId segment_id) const {
+        return g_.segment(segment_id).removed() || deleted_segments_.count(segment_id);
+    }
+
+    bool removed(DirectedSegment v) const { return removed(v.segment_id); }
+
+    //Numbers of non-deleted segments and arcs (every link has two arcs unless it connects a segment to its complement)
+    SegmentId live_segment_cnt() const;
+
+    size_t live_arc_cnt() const;
+
+    SegmentId segment_cnt() const { return g_.segment_cnt(); }
+
+    uint32_t outgoing_link_cnt(DirectedSegment v) const {
+        return live_degree_[v.AsInnerVertexT()];
+    }
+
+    bool unique_outgoing(DirectedSegment v) const {
+        return outgoing_link_cnt(v) == 1;
+    }
+
+    bool no_outgoing(DirectedSegment v) const {
+        return outgoing_link_cnt(v) == 0;
+    }
+
+    OverlayLinkIterator outgoing_begin(DirectedSegment v) const {
+        return OverlayLinkIterator(g_.outgoing_begin(v), g_.outgoing_end(v), &deleted_arcs_);
+    }
+
+    OverlayLinkIterator outgoing_end(DirectedSegment v) const {
+        return OverlayLinkIterator(g_.outgoing_end(v), g_.outgoing_end(v), &deleted_arcs_);
+    }
+
+    utils::ProxyContainer<OverlayLinkIterator> outgoing_links(DirectedSegment v) const {
+        return utils::ProxyContainer<OverlayLinkIterator>(outgoing_begin(v), outgoing_end(v));
+    }
+
+    uint32_t incoming_link_cnt(DirectedSegment v) const {
+        return live_degree_[v.Complement().AsInnerVertexT()];
+    }
+
+    bool unique_incoming(DirectedSegment v) const {
+        return incoming_link_cnt(v) == 1;
+    }
+
+    bool no_incoming(DirectedSegment v) const {
+        return incoming_link_cnt(v) == 0;
+    }
+
+    OverlayLinkIterator incoming_begin(DirectedSegment v) const {
+        return OverlayLinkIterator(g_.incoming_begin(v), g_.incoming_end(v), &deleted_arcs_);
+    }
+
+    OverlayLinkIterator incoming_end(DirectedSegment v) const {
+        return OverlayLinkIterator(g_.incoming_end(v), g_.incoming_end(v), &deleted_arcs_);
+    }
+
+    utils::ProxyContainer<OverlayLinkIterator> incoming_links(DirectedSegment v) const {
+        return utils::ProxyContainer<OverlayLinkIterator>(incoming_begin(v), incoming_end(v));
+    }
+
+    //Same as in the base graph, including the segments deleted in the overlay
+    utils::ProxyContainer<DirectedSegmentIterator> directed_segments() const { return g_.directed_segments(); }
+
+    utils::ProxyContainer<DirectedSegmentIterator> forward_segments() const { return g_.forward_segments(); }
+
+    std::string_view segment_name(SegmentId segment_id) const { return g_.segment_name(segment_id); }
+
+    std::string_view segment_name(DirectedSegment v) const { return g_.segment_name(v); }
+
+    size_t segment_length(SegmentId segment_id) const { return g_.segment_length(segment_id); }
+
+    size_t segment_length(DirectedSegment v) const { return g_.segment_length(v); }
+
+    size_t total_length(const Path &p) const { return g_.total_length(p); }
+
+    bool has_coverage() const { return g_.has_coverage(); }
+
+    double coverage(SegmentId segment_id) const { return g_.coverage(segment_id); }
+
+    double coverage(DirectedSegment v) const { return g_.coverage(v); }
+
+    bool IsCanonical(const LinkInfo &l) const { return g_.IsCanonical(l); }
+
+    template<class T>
+    std::string str(const T &x) const { return g_.str(x); }
+};
+
+}
@@ -0,0 +1,287 @@
+#include "packed_sequence.hpp"
+#include "tokenizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PACKED_SEQUENCE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace gfa {
+
+namespace {
+
+//Base j of a word occupies bits [2j, 2j + 2), i.e. 4 bases per byte in little-endian order
+const char NUCLS[] = "ACGT";
+const char COMPLEMENT_NUCLS[] = "TGCA";
+
+//Expects upper-case character
+int8_t Code(char c) {
+    switch (c) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default: return -1;
+    }
+}
+
+bool IsLower(char c) {
+    return c >= 'a' && c <= 'z';
+}
+
+//First run (of a sorted list) ending after pos
+template<class Runs>
+typename Runs::const_iterator FirstRunAfter(const Runs &runs, uint64_t pos) {
+    auto it = std::upper_bound(runs.begin(), runs.end(), pos,
+                               [](uint64_t p, const typename Runs::value_type &r) { return p < r.pos; });
+    if (it != runs.begin() && (it - 1)->pos + (it - 1)->len > pos)
+        --it;
+    return it;
+}
+
+//Decoded bytes: 4 bases per packed byte
+struct DecodeTable {
+    char forward[256][4];
+    char complement[256][4];
+
+    DecodeTable() {
+        for (unsigned b = 0; b < 256; ++b) {
+            for (unsigned j = 0; j < 4; ++j) {
+                forward[b][j] = NUCLS[(b >> (2 * j)) & 3];
+                complement[b][j] = COMPLEMENT_NUCLS[(b >> (2 * j)) & 3];
+            }
+        }
+    }
+};
+
+const DecodeTable decode_table;
+
+void DecodeScalar(const uint8_t *bytes, size_t byte_cnt, bool complement, char *out) {
+    const auto &table = complement ? decode_table.complement : decode_table.forward;
+    for (size_t i = 0; i < byte_cnt; ++i)
+        memcpy(out + 4 * i, table[bytes[i]], 4);
+}
+
+void ReverseScalar(char *b, size_t n) {
+    std::reverse(b, b + n);
+}
+
+#ifdef PACKED_SEQUENCE_X86
+
+//16 packed bytes -> 64 characters
+__attribute__((target("ssse3")))
+void DecodeSsse3(const uint8_t *bytes, size_t byte_cnt, bool complement, char *out) {
+    const __m128i lut = _mm_setr_epi8(complement ? 'T' : 'A', complement ? 'G' : 'C',
+                                      complement ? 'C' : 'G', complement ? 'A' : 'T',
+                                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask = _mm_set1_epi8(3);
+    for (; byte_cnt >= 16; byte_cnt -= 16, bytes += 16, out += 64) {
+        __m128i p = _mm_loadu_si128((const __m128i*) bytes);
+        //characters of base j within every byte
+        __m128i c0 = _mm_shuffle_epi8(lut, _mm_and_si128(p, mask));
+        __m128i c1 = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(p, 2), mask));
+        __m128i c2 = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(p, 4), mask));
+        __m128i c3 = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(p, 6), mask));
+        __m128i c01_lo = _mm_unpacklo_epi8(c0, c1), c01_hi = _mm_unpackhi_epi8(c0, c1);
+        __m128i c23_lo = _mm_unpacklo_epi8(c2, c3), c23_hi = _mm_unpackhi_epi8(c2, c3);
+        _mm_storeu_si128((__m128i*) out, _mm_unpacklo_epi16(c01_lo, c23_lo));
+        _mm_storeu_si128((__m128i*) (out + 16), _mm_unpackhi_epi16(c01_lo, c23_lo));
+        _mm_storeu_si128((__m128i*) (out + 32), _mm_unpacklo_epi16(c01_hi, c23_hi));
+        _mm_storeu_si128((__m128i*) (out + 48), _mm_unpackhi_epi16(c01_hi, c23_hi));
+    }
+    DecodeScalar(bytes, byte_cnt, complement, out);
+}
+
+__attribute__((target("ssse3")))
+void ReverseSsse3(char *b, size_t n) {
+    const __m128i rev = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    char *e = b + n;
+    for (; e - b >= 32; b += 16, e -= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) b);
+        __m128i y = _mm_loadu_si128((const __m128i*) (e - 16));
+        _mm_storeu_si128((__m128i*) b, _mm_shuffle_epi8(y, rev));
+        _mm_storeu_si128((__m128i*) (e - 16), _mm_shuffle_epi8(x, rev));
+    }
+    ReverseScalar(b, e - b);
+}
+
+//32 packed bytes -> 128 characters
+__attribute__((target("avx2")))
+void DecodeAvx2(const uint8_t *bytes, size_t byte_cnt, bool complement, char *out) {
+    const __m256i lut = _mm256_setr_epi8(complement ? 'T' : 'A', complement ? 'G' : 'C',
+                                         complement ? 'C' : 'G', complement ? 'A' : 'T',
+                                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                         complement ? 'T' : 'A', complement ? 'G' : 'C',
+                                         complement ? 'C' : 'G', complement ? 'A' : 'T',
+                                         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask = _mm256_set1_epi8(3);
+    for (; byte_cnt >= 32; byte_cnt -= 32, bytes += 32, out += 128) {
+        __m256i p = _mm256_loadu_si256((const __m256i*) bytes);
+        __m256i c0 = _mm256_shuffle_epi8(lut, _mm256_and_si256(p, mask));
+        __m256i c1 = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(p, 2), mask));
+        __m256i c2 = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(p, 4), mask));
+        __m256i c3 = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(p, 6), mask));
+        __m256i c01_lo = _mm256_unpacklo_epi8(c0, c1), c01_hi = _mm256_unpackhi_epi8(c0, c1);
+        __m256i c23_lo = _mm256_unpacklo_epi8(c2, c3), c23_hi = _mm256_unpackhi_epi8(c2, c3);
+        //unpacking works within 128-bit lanes: r0 holds bytes 0-3 | 16-19, r1 4-7 | 20-23, etc.
+        __m256i r0 = _mm256_unpacklo_epi16(c01_lo, c23_lo);
+        __m256i r1 = _mm256_unpackhi_epi16(c01_lo, c23_lo);
+        __m256i r2 = _mm256_unpacklo_epi16(c01_hi, c23_hi);
+        __m256i r3 = _mm256_unpackhi_epi16(c01_hi, c23_hi);
+        _mm256_storeu_si256((__m256i*) out, _mm256_permute2x128_si256(r0, r1, 0x20));
+        _mm256_storeu_si256((__m256i*) (out + 32), _mm256_permute2x128_si256(r2, r3, 0x20));
+        _mm256_storeu_si256((__m256i*) (out + 64), _mm256_permute2x128_si256(r0, r1, 0x31));
+        _mm256_storeu_si256((__m256i*) (out + 96), _mm256_permute2x128_si256(r2, r3, 0x31));
+    }
+    //avoiding AVX-SSE transition penalty in the non-VEX tail code
+    _mm256_zeroupper();
+    DecodeSsse3(bytes, byte_cnt, complement, out);
+}
+
+#endif
+
+void DecodeBytes(const uint8_t *bytes, size_t byte_cnt, bool complement, char *out) {
+    switch (utils::tokenizer::CurrentLevel()) {
+#ifdef PACKED_SEQUENCE_X86
+        case utils::tokenizer::Level::AVX2:
+            DecodeAvx2(bytes, byte_cnt, complement, out);
+            return;
+        case utils::tokenizer::Level::SSE42:
+            DecodeSsse3(bytes, byte_cnt, complement, out);
+            return;
+#endif
+        default:
+            DecodeScalar(bytes, byte_cnt, complement, out);
+    }
+}
+
+void Reverse(char *b, size_t n) {
+#ifdef PACKED_SEQUENCE_X86
+    if (utils::tokenizer::CurrentLevel() != utils::tokenizer::Level::SCALAR) {
+        ReverseSsse3(b, n);
+        return;
+    }
+#endif
+    ReverseScalar(b, n);
+}
+
+}
+
+const size_t PackedSequences::BASES_PER_WORD;
+const uint64_t PackedSequences::NONE;
+
+void AppendReverseComplement(const char *seq, size_t len, size_t trim, std::string &out) {
+    assert(trim <= len);
+    size_t start = out.size();
+    out.resize(start + len - trim);
+    char *o = &out[start];
+    for (size_t i = len - trim; i > 0; --i)
+        *(o++) = ComplementNucl(seq[i - 1]);
+}
+
+void PackedSequences::Decode(uint64_t pos, size_t n, bool complement, char *out) const {
+    const uint8_t *bytes = (const uint8_t*) words_.data();
+    const char *nucls = complement ? COMPLEMENT_NUCLS : NUCLS;
+    //unaligned head and tail are decoded base by base
+    for (; n > 0 && pos % 4 != 0; ++pos, --n)
+        *(out++) = nucls[(bytes[pos / 4] >> (2 * (pos % 4))) & 3];
+    DecodeBytes(bytes + pos / 4, n / 4, complement, out);
+    out += n / 4 * 4;
+    pos += n / 4 * 4;
+    for (n %= 4; n > 0; ++pos, --n)
+        *(out++) = nucls[(bytes[pos / 4] >> (2 * (pos % 4))) & 3];
+}
+
+uint64_t PackedSequences::Pack(const char *seq, size_t len) {
+    const uint64_t start = words_.size() * BASES_PER_WORD;
+    words_.resize(words_.size() + (len + BASES_PER_WORD - 1) / BASES_PER_WORD, 0);
+    uint64_t *w = words_.data() + start / BASES_PER_WORD;
+    for (size_t i = 0; i < len; ++i) {
+        char c = seq[i];
+        if (IsLower(c)) {
+            Run *last = lower_case_.empty() ? nullptr : &lower_case_.back();
+            if (last && last->pos + last->len == start + i)
+                ++last->len;
+            else
+                lower_case_.push_back(Run{start + i, 1});
+            c = char(c - 'a' + 'A');
+        }
+        int8_t code = Code(c);
+        if (code < 0) {
+            Exception *last = exceptions_.empty() ? nullptr : &exceptions_.back();
+            if (last && last->c == c && last->pos + last->len == start + i)
+                ++last->len;
+            else
+                exceptions_.push_back(Exception{start + i, 1, c});
+            code = 0;
+        }
+        w[i / BASES_PER_WORD] |= uint64_t(code) << (2 * (i % BASES_PER_WORD));
+    }
+    return start;
+}
+
+uint64_t PackedSequences::Append(const PackedSequences &other) {
+    const uint64_t shift = words_.size() * BASES_PER_WORD;
+    words_.insert(words_.end(), other.words_.begin(), other.words_.end());
+    exceptions_.reserve(exceptions_.size() + other.exceptions_.size());
+    for (Exception e : other.exceptions_) {
+        e.pos += shift;
+        exceptions_.push_back(e);
+    }
+    lower_case_.reserve(lower_case_.size() + other.lower_case_.size());
+    for (Run r : other.lower_case_) {
+        r.pos += shift;
+        lower_case_.push_back(r);
+    }
+    return shift;
+}
+
+void PackedSequences::Assign(uint32_t id, uint64_t pos, uint32_t len) {
+    if (starts_.size() <= id) {
+        starts_.resize(id + 1, NONE);
+        lengths_.resize(id + 1, 0);
+    }
+    starts_[id] = pos;
+    lengths_[id] = len;
+}
+
+void PackedSequences::Unpack(uint32_t id, bool reverse_complement, size_t trim, std::string &out) const {
+    if (!has_sequence(id))
+        return;
+    const uint64_t len = lengths_[id];
+    assert(trim <= len);
+    //range of the packed sequence to be output
+    const uint64_t b = starts_[id] + (reverse_complement ? 0 : trim);
+    const uint64_t e = starts_[id] + len - (reverse_complement ? trim : 0);
+
+    const size_t out_start = out.size();
+    out.resize(out_start + (e - b));
+    char *o = &out[out_start];
+    Decode(b, e - b, reverse_complement, o);
+    if (reverse_complement)
+        Reverse(o, e - b);
+
+    for (auto it = FirstRunAfter(exceptions_, b); it != exceptions_.end() && it->pos < e; ++it) {
+        const uint64_t ex_b = std::max(it->pos, b);
+        const uint64_t ex_e = std::min(it->pos + it->len, e);
+        if (reverse_complement)
+            memset(o + (e - ex_e), ComplementNucl(it->c), ex_e - ex_b);
+        else
+            memset(o + (ex_b - b), it->c, ex_e - ex_b);
+    }
+
+    //lower-case positions hold letters at this point (bases or upper-cased exceptions)
+    for (auto it = FirstRunAfter(lower_case_, b); it != lower_case_.end() && it->pos < e; ++it) {
+        const uint64_t r_b = std::max(it->pos, b);
+        const uint64_t r_e = std::min(it->pos + it->len, e);
+        char *p = o + (reverse_complement ? e - r_e : r_b - b);
+        for (uint64_t i = 0; i < r_e - r_b; ++i)
+            p[i] = char(p[i] | 0x20);
+    }
+}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gfa {
+
+//How segment sequences are kept in memory
+enum class SequenceMode {
+    //only names, lengths and links
+    SKIP,
+    //as loaded (char* per segment)
+    RAW,
+    //2-bit packed (see PackedSequences)
+    PACKED
+};
+
+inline
+char ComplementNucl(char c) {
+    switch (c) {
+        case 'A':
+            return 'T';
+        case 'a':
+            return 't';
+        case 'C':
+            return 'G';
+        case 'c':
+            return 'g';
+        case 'G':
+            return 'C';
+        case 'g':
+            return 'c';
+        case 'T':
+            return 'A';
+        case 't':
+            return 'a';
+        default:
+            return c;
+    }
+}
+
+//Appends reverse complement of seq[0, len - trim) to out
+void AppendReverseComplement(const char *seq, size_t len, size_t trim, std::string &out);
+
+//2-bit packed nucleotide sequences.
+//Case is kept separately as a sorted list of lower-case runs, so soft-masked bases are packed as well.
+//Characters other than ACGT are kept in a sorted list of exceptions (runs of the same upper-cased character).
+//Every sequence starts at a word boundary, so independently packed buffers
+//can be concatenated without re-packing (see Append).
+//Unpacking and reverse-complementing are vectorized (SSSE3/AVX2, chosen at runtime).
+class PackedSequences {
+public:
+    static const size_t BASES_PER_WORD = 32;
+    static const uint64_t NONE = uint64_t(-1);
+
+    struct Exception {
+        uint64_t pos;
+        uint32_t len;
+        char c;
+    };
+
+    struct Run {
+        uint64_t pos;
+        uint64_t len;
+    };
+
+private:
+    std::vector<uint64_t> words_;
+    std::vector<Exception> exceptions_;
+    std::vector<Run> lower_case_;
+    //indexed by sequence id
+    std::vector<uint64_t> starts_;
+    std::vector<uint32_t> lengths_;
+
+    //Unpacks (optionally complemented) bases [pos, pos + n) into out, exceptions are not applied
+    void Decode(uint64_t pos, size_t n, bool complement, char *out) const;
+
+public:
+    //Packs the sequence, returns position of its first base (to be passed to Assign)
+    uint64_t Pack(const char *seq, size_t len);
+
+    //Appends all packed data of another buffer (its ids are not transferred),
+    //returns the shift to be added to its positions
+    uint64_t Append(const PackedSequences &other);
+
+    //Sets sequence of id to the one packed at pos
+    void Assign(uint32_t id, uint64_t pos, uint32_t len);
+
+    //Renumbers sequences, new id i gets the sequence of id order[i] (packed data is not moved)
+    template<class Id>
+    void Permute(const std::vector<Id> &order) {
+        std::vector<uint64_t> starts(order.size(), NONE);
+        std::vector<uint32_t> lengths(order.size(), 0);
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (!has_sequence(uint32_t(order[i])))
+                continue;
+            starts[i] = starts_[order[i]];
+            lengths[i] = lengths_[order[i]];
+        }
+        starts_ = std::move(starts);
+        lengths_ = std::move(lengths);
+    }
+
+    bool has_sequence(uint32_t id) const {
+        return id < starts_.size() && starts_[id] != NONE;
+    }
+
+    uint32_t length(uint32_t id) const {
+        return lengths_[id];
+    }
+
+    //Appends sequence without the first trim bases to out,
+    //in case of reverse_complement the trimmed bases are taken from the start of reverse complement
+    void Unpack(uint32_t id, bool reverse_complement, size_t trim, std::string &out) const;
+
+    std::string Sequence(uint32_t id) const {
+        std::string answer;
+        Unpack(id, false, 0, answer);
+        return answer;
+    }
+
+    //Approximate memory footprint in bytes
+    size_t memory() const {
+        return words_.capacity() * sizeof(uint64_t) + exceptions_.capacity() * sizeof(Exception) +
+               lower_case_.capacity() * sizeof(Run) + starts_.capacity() * sizeof(uint64_t) + lengths_.capacity() * sizeof(uint32_t);
+    }
+};
+
+}
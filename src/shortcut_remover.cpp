@@ -19,7 +19,7 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 
 
     auto result = parse(argc, argv, cli);
-    assert(!cfg.coverage.empty());
+    assert(cfg.has_coverage());
     if (!result) {
         std::cerr << "Removing 'shortcut' links if the connected segments have coverage less than max_base_coverage "
                      "and 'start' can be accessed by an unambiguous path back passing over the nodes of coverage no less than min_path_coverage "
@@ -30,12 +30,11 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 }
 
 inline bool UnambiguousBackwardPath(const gfa::Graph &g, gfa::DirectedSegment w, gfa::DirectedSegment v,
-                                    const utils::SegmentCoverageMap &segment_cov,
                                     uint32_t min_path_coverage) {
     assert(w != v);
     std::set<gfa::LinkInfo> used_links;
     while (g.unique_incoming(w)
-            && utils::get(segment_cov, g.segment_name(w)) >= min_path_coverage
+            && g.coverage(w) >= min_path_coverage
             && w != v) {
         auto l = *g.incoming_begin(w);
         if (used_links.count(l)) {
@@ -50,14 +49,13 @@ inline bool UnambiguousBackwardPath(const gfa::Graph &g, gfa::DirectedSegment w,
 }
 
 inline bool UnambiguousBackwardAlternative(const gfa::Graph &g, gfa::DirectedSegment w, gfa::DirectedSegment v,
-                                           const utils::SegmentCoverageMap &segment_cov,
                                            uint32_t min_path_coverage) {
     for (auto l : g.incoming_links(w)) {
         assert(l.end == w);
         auto w1 = l.start;
         if (w1 == v || g.outgoing_link_cnt(w1) > 1)
             continue;
-        if (UnambiguousBackwardPath(g, w1, v, segment_cov, min_path_coverage)) {
+        if (UnambiguousBackwardPath(g, w1, v, min_path_coverage)) {
             return true;
         }
     }
@@ -70,13 +68,13 @@ int main(int argc, char *argv[]) {
 
     std::cout << "Max base segment coverage set to " << cfg.max_base_coverage << std::endl;
 
-    std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-    const auto segment_cov = utils::ReadCoverage(cfg.coverage);
 
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     //std::set<std::string> neighbourhood;
 
@@ -86,7 +84,7 @@ int main(int argc, char *argv[]) {
             continue;
 
         DEBUG("Looking at directed node v " << g.str(v));
-        if (utils::get(segment_cov, g.segment_name(v)) >= cfg.max_base_coverage) {
+        if (g.coverage(v) >= cfg.max_base_coverage) {
             DEBUG("Coverage of node v is too high");
             continue;
         }
@@ -97,12 +95,12 @@ int main(int argc, char *argv[]) {
 
             DEBUG("Looking at link to w " << g.str(w) << " (overlap size " << l.overlap() << ")");
 
-            if (utils::get(segment_cov, g.segment_name(v)) >= cfg.max_base_coverage) {
+            if (g.coverage(v) >= cfg.max_base_coverage) {
                 DEBUG("Coverage of node w is too high");
                 continue;
             }
 
-            if (UnambiguousBackwardAlternative(g, w, v, segment_cov, cfg.min_path_coverage)) {
+            if (UnambiguousBackwardAlternative(g, w, v, cfg.min_path_coverage)) {
                 DEBUG("Unambiguous backward alternative found");
                 std::cout << "Removing link " << g.str(v) << "," << g.str(w) << std::endl;
                 //std::cout << "Removing link " << g.str(v) << " -> " << g.str(w) << std::endl;
@@ -113,7 +111,7 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    tooling::OutputGraph(g, cfg, l_ndel, &segment_cov);
+    tooling::OutputGraph(g, cfg, l_ndel);
     std::cout << "END" << std::endl;
 }
 
@@ -59,8 +59,8 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
   ) % "algorithm settings");
 
   auto result = parse(argc, argv, cli);
-  if (cfg.use_coverage && cfg.coverage.empty()) {
-      std::cerr << "Option to use coverage values was enabled, but coverage file wasn't provided" << std::endl;
+  if (cfg.use_coverage && !cfg.has_coverage()) {
+      std::cerr << "Option to use coverage values was enabled, but neither coverage file nor coverage tag was provided" << std::endl;
       exit(2);
   }
 
@@ -71,8 +71,8 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 
   if (cfg.max_unique_cov != std::numeric_limits<double>::max() ||
       cfg.max_coverage_ratio != std::numeric_limits<double>::max()) {
-      if (cfg.coverage.empty()) {
-          std::cerr << "Provide --coverage file\n";
+      if (!cfg.has_coverage()) {
+          std::cerr << "Provide --coverage file or --coverage-tag\n";
           exit(2);
       }
   }
@@ -121,7 +121,7 @@ typedef std::function<bool (const gfa::Path &base, const gfa::Path &alt)> BulgeC
 inline bool FormsSimpleBulge(const gfa::Graph &g, gfa::DirectedSegment n,
                              size_t max_length,
                              const BulgeCheckF &check_f,
-                             std::set<gfa::SegmentId> &protected_segments) {
+                             utils::DenseSet<gfa::SegmentId> &protected_segments) {
     assert(g.unique_incoming(n) && g.unique_outgoing(n));
     DEBUG("Considering node " << g.str(n));
     gfa::Path p({*g.incoming_begin(n), *g.outgoing_begin(n)});
@@ -172,23 +172,18 @@ int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     //std::set<std::string> neighbourhood;
-    std::set<gfa::SegmentId> protected_segments;
+    utils::DenseSet<gfa::SegmentId> protected_segments(g.segment_cnt());
 
     auto cov_f = [&](gfa::DirectedSegment v) {
-        assert(segment_cov_ptr);
-        return double(utils::get(*segment_cov_ptr, g.segment_name(v)));
+        return g.coverage(v);
     };
 
     //min(unique_left_ovl, unique_right_ovl) & segment_id
@@ -208,8 +203,12 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    //sort in order of increased min overlaps or coverage
-    std::sort(segments_of_interest.begin(), segments_of_interest.end());
+    //sort in order of increased min overlaps or coverage,
+    //ties are broken by the input order, so that the result doesn't depend on --reorder
+    std::sort(segments_of_interest.begin(), segments_of_interest.end(),
+              [&](const std::pair<double, gfa::SegmentId> &a, const std::pair<double, gfa::SegmentId> &b) {
+        return std::make_pair(a.first, g.input_position(a.second)) < std::make_pair(b.first, g.input_position(b.second));
+    });
 
     auto inner_cov_f = [&](const gfa::Path &p) {
         assert(p.segment_cnt() >= 3);
@@ -242,7 +241,7 @@ int main(int argc, char *argv[]) {
             return false;
         }
 
-        if (segment_cov_ptr) {
+        if (g.has_coverage()) {
             //todo can be optimized if the check is actually disabled
             auto v = base.segments.front();
             auto w = base.segments.back();
@@ -279,7 +278,7 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    tooling::OutputGraph(g, cfg, ndel, segment_cov_ptr.get());
+    tooling::OutputGraph(g, cfg, ndel);
 
     std::cout << "END" << std::endl;
 }
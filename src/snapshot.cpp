@@ -0,0 +1,341 @@
+#include "snapshot.hpp"
+#include "gfa-priv.h"
+#include "utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gfa {
+namespace io {
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'G', 'F', 'A', 'C', 'P', 'P', 'B', '\0'};
+const char SNAPSHOT_EXT[] = ".gfab";
+const uint64_t NO_SEQUENCE = uint64_t(-1);
+
+enum SnapshotFlags : uint32_t {
+    HAS_SEQUENCE = 1,
+    HAS_COVERAGE = 2
+};
+
+//All sections start at 8-byte aligned offsets from the beginning of the file
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t segment_cnt;
+    uint64_t arc_cnt;
+    //guards against gfatools arc layout changes
+    uint32_t arc_size;
+    uint32_t reserved;
+    //int32_t[segment_cnt]
+    uint64_t lengths_off;
+    //uint64_t[segment_cnt + 1] offsets relative to name blob, followed by the blob of 0-terminated names
+    uint64_t names_off;
+    uint64_t name_blob_off;
+    //uint64_t[segment_cnt] offsets relative to sequence blob (NO_SEQUENCE if absent), followed by the blob
+    uint64_t seqs_off;
+    uint64_t seq_blob_off;
+    //gfa_arc_t[arc_cnt]
+    uint64_t arcs_off;
+    //uint64_t[2 * segment_cnt], same as gfa_t::idx
+    uint64_t idx_off;
+    //double[segment_cnt]
+    uint64_t coverage_off;
+    uint64_t file_size;
+};
+
+class SnapshotWriter {
+    FILE *f_;
+    uint64_t pos_;
+
+public:
+    explicit SnapshotWriter(FILE *f): f_(f), pos_(0) {}
+
+    uint64_t pos() const { return pos_; }
+
+    void Write(const void *data, size_t size) {
+        if (size > 0)
+            fwrite(data, 1, size, f_);
+        pos_ += size;
+    }
+
+    template<class T>
+    uint64_t WriteVec(const std::vector<T> &v) {
+        Align();
+        uint64_t start = pos_;
+        Write(v.data(), v.size() * sizeof(T));
+        return start;
+    }
+
+    void Align() {
+        static const char zeros[8] = {0};
+        Write(zeros, (8 - pos_ % 8) % 8);
+    }
+};
+
+}
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string &filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = st.st_size;
+    void *data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return nullptr;
+    return std::shared_ptr<MappedFile>(new MappedFile((const char*) data, size));
+}
+
+MappedFile::~MappedFile() {
+    if (data_)
+        munmap((void*) data_, size_);
+}
+
+bool IsSnapshotFilename(const std::string &filename) {
+    const size_t ext_len = strlen(SNAPSHOT_EXT);
+    return filename.size() > ext_len &&
+           filename.compare(filename.size() - ext_len, ext_len, SNAPSHOT_EXT) == 0;
+}
+
+bool IsSnapshot(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    bool answer = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                  memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+    return answer;
+}
+
+gfa_t *ReadSnapshot(const std::string &filename,
+                    std::shared_ptr<MappedFile> &mapping,
+                    std::vector<double> &coverage,
+                    bool load_sequence) {
+    auto m = MappedFile::Open(filename);
+    if (!m || m->size() < sizeof(SnapshotHeader))
+        return nullptr;
+
+    const char *data = m->data();
+    SnapshotHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) {
+        WARN("File " << filename << " is not a graph snapshot");
+        return nullptr;
+    }
+    if (h.version != SNAPSHOT_VERSION || h.arc_size != sizeof(gfa_arc_t) || h.file_size != m->size()) {
+        WARN("Incompatible or corrupted graph snapshot " << filename << " (version " << h.version << ")");
+        return nullptr;
+    }
+
+    //sections have to be aligned and lie within the file (checked without overflows)
+    const uint64_t size = m->size();
+    auto valid_section = [size](uint64_t off, uint64_t cnt, uint64_t elem_size) {
+        return off % 8 == 0 && off <= size && cnt <= (size - off) / elem_size;
+    };
+    const bool load_seqs = load_sequence && (h.flags & HAS_SEQUENCE);
+    bool valid = h.segment_cnt < std::numeric_limits<uint32_t>::max() / 2
+                 && valid_section(h.lengths_off, h.segment_cnt, sizeof(int32_t))
+                 && valid_section(h.names_off, h.segment_cnt + 1, sizeof(uint64_t))
+                 && h.name_blob_off <= size
+                 && valid_section(h.arcs_off, h.arc_cnt, sizeof(gfa_arc_t))
+                 && valid_section(h.idx_off, 2 * h.segment_cnt, sizeof(uint64_t))
+                 && (!load_seqs || (valid_section(h.seqs_off, h.segment_cnt, sizeof(uint64_t))
+                                    && h.seq_blob_off <= size))
+                 && (!(h.flags & HAS_COVERAGE) || valid_section(h.coverage_off, h.segment_cnt, sizeof(double)));
+    if (!valid) {
+        WARN("Corrupted graph snapshot " << filename << " (sections out of bounds)");
+        return nullptr;
+    }
+
+    const int32_t *lengths = (const int32_t*) (data + h.lengths_off);
+    const uint64_t *name_offs = (const uint64_t*) (data + h.names_off);
+    const char *names = data + h.name_blob_off;
+    const uint64_t *seq_offs = load_seqs ? (const uint64_t*) (data + h.seqs_off) : nullptr;
+    const char *seqs = data + h.seq_blob_off;
+    const uint64_t *idx = (const uint64_t*) (data + h.idx_off);
+    const gfa_arc_t *arcs = (const gfa_arc_t*) (data + h.arcs_off);
+
+    //names, sequences and arc index have to point into their sections
+    const uint64_t name_blob_size = size - h.name_blob_off;
+    for (uint64_t i = 0; valid && i < h.segment_cnt; ++i) {
+        valid = name_offs[i] < name_offs[i + 1] && name_offs[i + 1] <= name_blob_size
+                && names[name_offs[i + 1] - 1] == '\0' && lengths[i] >= 0;
+        if (valid && seq_offs && seq_offs[i] != NO_SEQUENCE)
+            valid = seq_offs[i] < size - h.seq_blob_off
+                    && uint64_t(lengths[i]) < size - h.seq_blob_off - seq_offs[i]
+                    && seqs[seq_offs[i] + lengths[i]] == '\0';
+    }
+    for (uint64_t v = 0; valid && v < 2 * h.segment_cnt; ++v)
+        valid = (idx[v] >> 32) + uint32_t(idx[v]) <= h.arc_cnt;
+    for (uint64_t k = 0; valid && k < h.arc_cnt; ++k)
+        valid = (arcs[k].v_lv >> 32) < 2 * h.segment_cnt && arcs[k].w < 2 * h.segment_cnt;
+    if (!valid) {
+        WARN("Corrupted graph snapshot " << filename);
+        return nullptr;
+    }
+
+    gfa_t *g = gfa_init();
+    for (uint64_t i = 0; i < h.segment_cnt; ++i) {
+        int32_t sid = gfa_add_seg(g, names + name_offs[i]);
+        assert(uint64_t(sid) == i);
+        gfa_seg_t *s = &g->seg[sid];
+        s->len = lengths[i];
+        s->seq = (seq_offs && seq_offs[i] != NO_SEQUENCE) ? (char*) (seqs + seq_offs[i]) : nullptr;
+    }
+
+    g->n_arc = g->m_arc = h.arc_cnt;
+    g->arc = (gfa_arc_t*) malloc(std::max(h.arc_cnt, uint64_t(1)) * sizeof(gfa_arc_t));
+    memcpy(g->arc, arcs, h.arc_cnt * sizeof(gfa_arc_t));
+    g->link_aux = (gfa_aux_t*) calloc(std::max(h.arc_cnt, uint64_t(1)), sizeof(gfa_aux_t));
+    g->idx = (uint64_t*) malloc(std::max(2 * h.segment_cnt, uint64_t(1)) * sizeof(uint64_t));
+    memcpy(g->idx, idx, 2 * h.segment_cnt * sizeof(uint64_t));
+
+    coverage.clear();
+    if (h.flags & HAS_COVERAGE) {
+        const double *cov = (const double*) (data + h.coverage_off);
+        coverage.assign(cov, cov + h.segment_cnt);
+    }
+
+    mapping = std::move(m);
+    return g;
+}
+
+bool WriteSnapshot(const gfa_t *g, const std::string &filename,
+                   bool drop_sequence,
+                   const std::vector<double> &coverage) {
+    assert(coverage.empty() || coverage.size() == g->n_seg);
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (!f)
+        return false;
+
+    std::vector<uint32_t> new_ids(g->n_seg, uint32_t(-1));
+    std::vector<uint32_t> kept;
+    kept.reserve(g->n_seg);
+    for (uint32_t i = 0; i < g->n_seg; ++i) {
+        if (!g->seg[i].del) {
+            new_ids[i] = uint32_t(kept.size());
+            kept.push_back(i);
+        }
+    }
+    const uint64_t n = kept.size();
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.segment_cnt = n;
+    h.arc_size = sizeof(gfa_arc_t);
+
+    SnapshotWriter w(f);
+    w.Write(&h, sizeof(h));
+
+    {
+        std::vector<int32_t> lengths(n);
+        for (uint64_t i = 0; i < n; ++i)
+            lengths[i] = g->seg[kept[i]].len;
+        h.lengths_off = w.WriteVec(lengths);
+    }
+
+    {
+        std::vector<uint64_t> offs(n + 1, 0);
+        for (uint64_t i = 0; i < n; ++i)
+            offs[i + 1] = offs[i] + strlen(g->seg[kept[i]].name) + 1;
+        h.names_off = w.WriteVec(offs);
+        w.Align();
+        h.name_blob_off = w.pos();
+        for (uint64_t i = 0; i < n; ++i)
+            w.Write(g->seg[kept[i]].name, offs[i + 1] - offs[i]);
+    }
+
+    if (!drop_sequence) {
+        h.flags |= HAS_SEQUENCE;
+        std::vector<uint64_t> offs(n, NO_SEQUENCE);
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            const char *seq = g->seg[kept[i]].seq;
+            if (seq) {
+                offs[i] = total;
+                total += strlen(seq) + 1;
+            }
+        }
+        h.seqs_off = w.WriteVec(offs);
+        w.Align();
+        h.seq_blob_off = w.pos();
+        for (uint64_t i = 0; i < n; ++i) {
+            const char *seq = g->seg[kept[i]].seq;
+            if (seq)
+                w.Write(seq, strlen(seq) + 1);
+        }
+    }
+
+    {
+        //arcs are grouped by source vertex, which keeps them sorted since renumbering preserves the order
+        std::vector<uint64_t> idx(2 * n, 0);
+        std::vector<uint64_t> new_link_ids;
+        const uint64_t NO_LINK = uint64_t(-1);
+        std::vector<gfa_arc_t> buf;
+        w.Align();
+        h.arcs_off = w.pos();
+        uint64_t arc_cnt = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            for (uint32_t o = 0; o < 2; ++o) {
+                uint32_t v = kept[i] << 1 | o;
+                const gfa_arc_t *av = gfa_arc_a(g, v);
+                uint32_t nv = gfa_arc_n(g, v);
+                uint64_t start = arc_cnt;
+                buf.clear();
+                for (uint32_t j = 0; j < nv; ++j) {
+                    gfa_arc_t a = av[j];
+                    if (a.del || g->seg[a.w >> 1].del)
+                        continue;
+                    if (a.link_id >= new_link_ids.size())
+                        new_link_ids.resize(a.link_id + 1, NO_LINK);
+                    if (new_link_ids[a.link_id] == NO_LINK)
+                        new_link_ids[a.link_id] = arc_cnt;
+                    a.v_lv = uint64_t(new_ids[v >> 1] << 1 | o) << 32 | uint32_t(a.v_lv);
+                    a.w = new_ids[a.w >> 1] << 1 | (a.w & 1);
+                    a.link_id = new_link_ids[a.link_id];
+                    buf.push_back(a);
+                    ++arc_cnt;
+                }
+                w.Write(buf.data(), buf.size() * sizeof(gfa_arc_t));
+                idx[i << 1 | o] = start << 32 | (arc_cnt - start);
+            }
+        }
+        h.arc_cnt = arc_cnt;
+        h.idx_off = w.WriteVec(idx);
+    }
+
+    if (!coverage.empty()) {
+        h.flags |= HAS_COVERAGE;
+        std::vector<double> cov(n);
+        for (uint64_t i = 0; i < n; ++i)
+            cov[i] = coverage[kept[i]];
+        h.coverage_off = w.WriteVec(cov);
+    }
+
+    h.file_size = w.pos();
+    fseek(f, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, f);
+    bool ok = !ferror(f);
+    return (fclose(f) == 0) && ok;
+}
+
+}
+}
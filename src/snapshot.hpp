@@ -0,0 +1,63 @@
+#pragma once
+
+#include "gfa.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gfa {
+namespace io {
+
+//Read-only memory mapping of a whole file
+class MappedFile {
+    const char *data_;
+    size_t size_;
+
+    MappedFile(const char *data, size_t size): data_(data), size_(size) {}
+
+public:
+    static std::shared_ptr<MappedFile> Open(const std::string &filename);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    const char *data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+    bool contains(const void *p) const {
+        return p >= (const void*) data_ && p < (const void*) (data_ + size_);
+    }
+};
+
+//Binary graph snapshot (*.gfab)
+//Sections: segment lengths, names, optional sequences, arcs, arc index, optional coverage.
+//Loading involves no parsing: arcs and arc index are copied in bulk,
+//while sequences are used directly from the mapped file.
+const uint32_t SNAPSHOT_VERSION = 1;
+
+//Snapshot is chosen for output by extension
+bool IsSnapshotFilename(const std::string &filename);
+
+//Snapshot is detected on input by its magic
+bool IsSnapshot(const std::string &filename);
+
+//Sequences of the returned graph point into the mapping,
+//they have to be detached before gfa_destroy (see Graph::Reset)
+//Coverage is left empty if it wasn't stored
+gfa_t *ReadSnapshot(const std::string &filename,
+                    std::shared_ptr<MappedFile> &mapping,
+                    std::vector<double> &coverage,
+                    bool load_sequence = true);
+
+//Deleted segments and arcs are skipped, remaining segments are renumbered preserving the order
+//Coverage (if non-empty) has to be indexed by segment id
+bool WriteSnapshot(const gfa_t *g, const std::string &filename,
+                   bool drop_sequence = false,
+                   const std::vector<double> &coverage = std::vector<double>());
+
+}
+}
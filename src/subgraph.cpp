@@ -0,0 +1,76 @@
+#include "subgraph.hpp"
+
+#include <fstream>
+
+namespace gfa {
+
+InducedSubgraph::InducedSubgraph(const Graph &g, std::vector<SegmentId> members):
+        g_(g), membership_(g.segment_cnt()) {
+    members_.reserve(members.size());
+    for (SegmentId segment_id : members) {
+        assert(segment_id < g.segment_cnt());
+        if (!g.segment(segment_id).removed() && membership_.insert(segment_id))
+            members_.push_back(segment_id);
+    }
+    std::sort(members_.begin(), members_.end(), [&](SegmentId a, SegmentId b) {
+        return g.input_position(a) < g.input_position(b);
+    });
+}
+
+size_t InducedSubgraph::link_cnt() const {
+    size_t cnt = 0;
+    for (DirectedSegment v : directed_segments())
+        cnt += outgoing_link_cnt(v);
+    return cnt;
+}
+
+void InducedSubgraph::write(const std::string &filename) const {
+    std::ofstream out(filename);
+    //reused for every output line
+    std::string line;
+
+    for (DirectedSegment v : forward_segments()) {
+        const auto seg = g_.segment(v);
+        line.clear();
+        line += "S\t";
+        line += seg.name;
+        line += '\t';
+        const size_t seq_start = line.size();
+        g_.AppendSequence(v, 0, line);
+        if (line.size() == seq_start)
+            line += '*';
+        line += "\tLN:i:";
+        utils::AppendInt(line, seg.length);
+
+        if (g_.has_coverage()) {
+            double cov = g_.coverage(v);
+            //adding Mikko-style output to simplify scripting
+            line += "\tRC:i:";
+            utils::AppendInt(line, uint64_t(std::round(cov * seg.length)));
+            line += "\tll:f:";
+            utils::AppendDouble(line, std::round(cov * 1000) / 1000);
+        }
+        line += '\n';
+        out.write(line.data(), line.size());
+    }
+
+    //links are grouped by the start, in input order of its segment
+    for (DirectedSegment v : directed_segments()) {
+        for (const auto &l : outgoing_links(v)) {
+            if (!IsCanonical(l))
+                continue;
+            //TODO support CIGAR?
+            line.clear();
+            line += "L\t";
+            g_.AppendStr(line, l.start, "\t");
+            line += '\t';
+            g_.AppendStr(line, l.end, "\t");
+            line += '\t';
+            utils::AppendInt(line, l.overlap());
+            line += "M\n";
+            out.write(line.data(), line.size());
+        }
+    }
+}
+
+}
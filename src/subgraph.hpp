@@ -0,0 +1,179 @@
+#pragma once
+
+#include "wrapper.hpp"
+#include "utils.hpp"
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace gfa {
+
+//Skips links with an end outside of the member set
+class SubgraphLinkIterator {
+    LinkIterator it_;
+    LinkIterator end_;
+    const utils::DenseSet<SegmentId> *members_;
+
+    bool Inside(const LinkInfo &l) const {
+        return members_->count(l.start.segment_id) && members_->count(l.end.segment_id);
+    }
+
+    void SkipOutside() {
+        while (it_ != end_ && !Inside(*it_))
+            ++it_;
+    }
+
+public:
+    SubgraphLinkIterator(LinkIterator it, LinkIterator end, const utils::DenseSet<SegmentId> *members) :
+        it_(it), end_(end), members_(members) {
+        SkipOutside();
+    }
+
+    SubgraphLinkIterator& operator++() {
+        ++it_;
+        SkipOutside();
+        return *this;
+    }
+
+    SubgraphLinkIterator operator++(int) {
+        auto retval = *this;
+        ++(*this);
+        return retval;
+    }
+
+    bool operator==(const SubgraphLinkIterator &other) const {
+        return it_ == other.it_;
+    }
+
+    bool operator!=(const SubgraphLinkIterator &other) const {
+        return !(*this == other);
+    }
+
+    LinkInfo operator*() const {
+        return *it_;
+    }
+
+    // iterator traits
+    using difference_type = ptrdiff_t;
+    using value_type = LinkInfo;
+    using pointer = const LinkInfo*;
+    using reference = const LinkInfo&;
+    using iterator_category = std::forward_iterator_tag;
+};
+
+//View of the subgraph induced by a set of segments: all links between the members of the base graph.
+//Nothing is copied, traversal API of Graph is restricted to the members,
+//link counts take time linear in the degree of the base graph.
+//Takes a bit per segment of the base graph plus the member list, invalidated by modifications of the base graph
+class InducedSubgraph {
+    const Graph &g_;
+    utils::DenseSet<SegmentId> membership_;
+    //member ids in input order of the base graph
+    std::vector<SegmentId> members_;
+
+public:
+    //Duplicates and removed segments are ignored
+    InducedSubgraph(const Graph &g, std::vector<SegmentId> members);
+
+    const Graph &base() const { return g_; }
+
+    bool contains(SegmentId segment_id) const { return membership_.count(segment_id); }
+
+    bool contains(DirectedSegment v) const { return contains(v.segment_id); }
+
+    SegmentId segment_cnt() const { return SegmentId(members_.size()); }
+
+    //Number of arcs between members (see Graph::link_cnt), in O(subgraph size)
+    size_t link_cnt() const;
+
+    const std::vector<SegmentId> &members() const { return members_; }
+
+    //Both orientations of each member, members in input order of the base graph
+    utils::ProxyContainer<DirectedSegmentIterator> directed_segments() const {
+        return utils::ProxyContainer<DirectedSegmentIterator>(
+                DirectedSegmentIterator(0, members_.data()),
+                DirectedSegmentIterator(2 * members_.size(), members_.data()));
+    }
+
+    utils::ProxyContainer<DirectedSegmentIterator> forward_segments() const {
+        return utils::ProxyContainer<DirectedSegmentIterator>(
+                DirectedSegmentIterator(0, members_.data(), /*forward only*/true),
+                DirectedSegmentIterator(members_.size(), members_.data(), /*forward only*/true));
+    }
+
+    SubgraphLinkIterator outgoing_begin(DirectedSegment v) const {
+        return SubgraphLinkIterator(g_.outgoing_begin(v), g_.outgoing_end(v), &membership_);
+    }
+
+    SubgraphLinkIterator outgoing_end(DirectedSegment v) const {
+        return SubgraphLinkIterator(g_.outgoing_end(v), g_.outgoing_end(v), &membership_);
+    }
+
+    utils::ProxyContainer<SubgraphLinkIterator> outgoing_links(DirectedSegment v) const {
+        return utils::ProxyContainer<SubgraphLinkIterator>(outgoing_begin(v), outgoing_end(v));
+    }
+
+    uint32_t outgoing_link_cnt(DirectedSegment v) const {
+        return uint32_t(std::distance(outgoing_begin(v), outgoing_end(v)));
+    }
+
+    bool unique_outgoing(DirectedSegment v) const {
+        return outgoing_link_cnt(v) == 1;
+    }
+
+    bool no_outgoing(DirectedSegment v) const {
+        return outgoing_begin(v) == outgoing_end(v);
+    }
+
+    SubgraphLinkIterator incoming_begin(DirectedSegment v) const {
+        return SubgraphLinkIterator(g_.incoming_begin(v), g_.incoming_end(v), &membership_);
+    }
+
+    SubgraphLinkIterator incoming_end(DirectedSegment v) const {
+        return SubgraphLinkIterator(g_.incoming_end(v), g_.incoming_end(v), &membership_);
+    }
+
+    utils::ProxyContainer<SubgraphLinkIterator> incoming_links(DirectedSegment v) const {
+        return utils::ProxyContainer<SubgraphLinkIterator>(incoming_begin(v), incoming_end(v));
+    }
+
+    uint32_t incoming_link_cnt(DirectedSegment v) const {
+        return uint32_t(std::distance(incoming_begin(v), incoming_end(v)));
+    }
+
+    bool unique_incoming(DirectedSegment v) const {
+        return incoming_link_cnt(v) == 1;
+    }
+
+    bool no_incoming(DirectedSegment v) const {
+        return incoming_begin(v) == incoming_end(v);
+    }
+
+    std::string_view segment_name(SegmentId segment_id) const { return g_.segment_name(segment_id); }
+
+    std::string_view segment_name(DirectedSegment v) const { return g_.segment_name(v); }
+
+    size_t segment_length(SegmentId segment_id) const { return g_.segment_length(segment_id); }
+
+    size_t segment_length(DirectedSegment v) const { return g_.segment_length(v); }
+
+    size_t total_length(const Path &p) const { return g_.total_length(p); }
+
+    bool has_coverage() const { return g_.has_coverage(); }
+
+    double coverage(SegmentId segment_id) const { return g_.coverage(segment_id); }
+
+    double coverage(DirectedSegment v) const { return g_.coverage(v); }
+
+    bool IsCanonical(const LinkInfo &l) const { return g_.IsCanonical(l); }
+
+    template<class T>
+    std::string str(const T &x) const { return g_.str(x); }
+
+    //Writes S-lines of the members (with LN tag, and RC/ll tags if coverage is available)
+    //followed by L-lines of canonical links between them, in O(subgraph size)
+    void write(const std::string &filename) const;
+};
+
+}
@@ -13,15 +13,38 @@
 
 namespace bubbles {
 
+//Orders directed segments by their positions in the input, so that the search doesn't depend on reordering
+class InputOrderLess {
+    const gfa::Graph *g_;
+
+public:
+    explicit InputOrderLess(const gfa::Graph &g): g_(&g) {}
+
+    bool operator()(gfa::DirectedSegment a, gfa::DirectedSegment b) const {
+        return std::make_pair(g_->input_position(a.segment_id), a.direction)
+               < std::make_pair(g_->input_position(b.segment_id), b.direction);
+    }
+};
+
+//Graph the adjacency belongs to (names, lengths and input order are taken from it)
+inline const gfa::Graph &AdjacencyGraph(const gfa::Graph &g) { return g; }
+
+template<class Adjacency>
+const gfa::Graph &AdjacencyGraph(const Adjacency &adj) { return adj.graph(); }
+
+//Searches on the Graph itself or on any adjacency snapshot with the same link API (e.g. CsrGraph)
 //TODO update to pseudo-code from miniasm paper
-class SuperbubbleFinder {
+template<class Adjacency>
+class BasicSuperbubbleFinder {
 public:
     typedef gfa::DirectedSegment DirectedSegment;
     typedef std::function<double (DirectedSegment)> SegmentCoverageF;
     typedef gfa::LinkInfo LinkInfo;
+    typedef std::set<DirectedSegment, InputOrderLess> SegmentSet;
 
 private:
     const gfa::Graph& g_;
+    const Adjacency& adj_;
     DirectedSegment start_vertex_;
     SegmentCoverageF segment_cov_;
     size_t max_length_;
@@ -38,7 +61,7 @@ private:
     //TODO consider switching to counters like in Heng's pseudo-code
     bool CheckCanBeProcessed(DirectedSegment v) const {
         DEBUG("Check if vertex " << g_.str(v) << " is dominated close neighbour");
-        for (const LinkInfo &l : g_.incoming_links(v)) {
+        for (const LinkInfo &l : adj_.incoming_links(v)) {
             assert(l.end == v);
             DirectedSegment neighbour_v = l.start;
             if (superbubble_vertices_.count(neighbour_v) == 0) {
@@ -52,10 +75,10 @@ private:
     }
 
     void UpdateCanBeProcessed(DirectedSegment v,
-                              std::set<DirectedSegment>& can_be_processed,
-                              std::set<DirectedSegment>& border) const {
+                              SegmentSet& can_be_processed,
+                              SegmentSet& border) const {
         DEBUG("Updating can be processed");
-        for (const LinkInfo &l : g_.outgoing_links(v)) {
+        for (const LinkInfo &l : adj_.outgoing_links(v)) {
             assert(l.start == v);
             DirectedSegment neighbour_v = l.end;
             DEBUG("Considering neighbor " << g_.str(neighbour_v));
@@ -74,7 +97,7 @@ private:
     }
 
     bool CheckNoEdgeToStart(DirectedSegment v) {
-        for (const LinkInfo &l : g_.outgoing_links(v)) {
+        for (const LinkInfo &l : adj_.outgoing_links(v)) {
             assert(l.start == v);
             DirectedSegment neighbour_v = l.end;
             if (neighbour_v == start_vertex_) {
@@ -85,9 +108,10 @@ private:
     }
 
 public:
-    SuperbubbleFinder(const gfa::Graph& g, DirectedSegment v, SegmentCoverageF segment_cov = nullptr,
-                      size_t max_length = -1ull, size_t max_diff = -1ull, size_t max_count = -1ull)
-            : g_(g),
+    BasicSuperbubbleFinder(const Adjacency& adj, DirectedSegment v, SegmentCoverageF segment_cov = nullptr,
+                           size_t max_length = -1ull, size_t max_diff = -1ull, size_t max_count = -1ull)
+            : g_(AdjacencyGraph(adj)),
+              adj_(adj),
               start_vertex_(v),
               segment_cov_(segment_cov),
               max_length_(max_length),
@@ -100,7 +124,7 @@ public:
     //todo handle case when first/last vertex have other outgoing/incoming edges
     //true if no thresholds exceeded
     bool FindSuperbubble() {
-        if (g_.outgoing_link_cnt(start_vertex_) < 2) {
+        if (adj_.outgoing_link_cnt(start_vertex_) < 2) {
             return false;
         }
         DEBUG("Adding starting vertex " << g_.str(start_vertex_) << " to dominated set");
@@ -112,8 +136,8 @@ public:
 
         heaviest_backtrace_[start_vertex_] = LinkInfo();
         cnt_++;
-        std::set<DirectedSegment> can_be_processed;
-        std::set<DirectedSegment> border;
+        SegmentSet can_be_processed{InputOrderLess(g_)};
+        SegmentSet border{InputOrderLess(g_)};
         UpdateCanBeProcessed(start_vertex_, can_be_processed, border);
         //prevents the corner case of 'bubble' of single link and loop on the start node
         bool nontrivial = false;
@@ -145,11 +169,11 @@ public:
             double max_w = -1.;
             LinkInfo best_entrance;
 
-            assert(g_.incoming_link_cnt(v) > 0);
+            assert(adj_.incoming_link_cnt(v) > 0);
             assert(is_end || CheckCanBeProcessed(v));
 
             uint32_t used_incoming_cnt = 0;
-            for (const LinkInfo &l : g_.incoming_links(v)) {
+            for (const LinkInfo &l : adj_.incoming_links(v)) {
                 assert(l.end == v);
                 DirectedSegment neighbour_v = l.start;
                 //in case of dominated_only == false
@@ -201,7 +225,7 @@ public:
                 if (!CheckNoEdgeToStart(v))
                     break;
                 //All added nodes have to have an outgoing edge
-                if (g_.outgoing_link_cnt(v) == 0)
+                if (adj_.outgoing_link_cnt(v) == 0)
                     break;
             }
 
@@ -244,8 +268,8 @@ public:
     //    return superbubble_vertices_;
     //}
 
-    std::set<DirectedSegment> segments() const {
-        std::set<DirectedSegment> answer;
+    SegmentSet segments() const {
+        SegmentSet answer{InputOrderLess(g_)};
         for (const auto n_i : superbubble_vertices_) {
             answer.insert(n_i.first);
         }
@@ -286,4 +310,6 @@ public:
 
 };
 
+typedef BasicSuperbubbleFinder<gfa::Graph> SuperbubbleFinder;
+
 }
@@ -27,21 +27,22 @@ int main(int argc, char *argv[]) {
     const std::string in_fn(cfg.graph_in);
     const std::string out_fn(cfg.graph_out);
 
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << in_fn << std::endl;
-    g.open(in_fn);
+    g.open(in_fn, cfg.threads, cfg.drop_sequence ? gfa::SequenceMode::SKIP : gfa::SequenceMode::PACKED,
+           cfg.coverage_tag);
 
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
     //gfa::CompactAndWrite(g, out_fn);
-    gfa::Compactifier compactifier(g, cfg.compacted_prefix, segment_cov_ptr.get(), cfg.dbg_k, /*normalize overlaps*/true);
+    gfa::Compactifier compactifier(g, cfg.compacted_prefix, g.has_coverage(), cfg.dbg_k, /*normalize overlaps*/true);
     std::cout << "Writing compacted graph to " << out_fn << std::endl;
-    compactifier.Compact(out_fn, cfg.id_mapping, cfg.drop_sequence, cfg.rename_all);
+    if (!compactifier.Compact(out_fn, cfg.id_mapping, cfg.drop_sequence, cfg.rename_all,
+                              gfa::io::CompressedOutput(out_fn, cfg.compress_out), cfg.threads)) {
+        std::cerr << "Failed to write graph to " << out_fn << std::endl;
+        exit(3);
+    }
     std::cout << "Writing complete" << std::endl;
     std::cout << "Done" << std::endl;
 }
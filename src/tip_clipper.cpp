@@ -4,6 +4,7 @@
 #include <vector>
 #include <set>
 #include <cassert>
+#include <cmath>
 
 struct cmd_cfg: public tooling::cmd_cfg_base {
     //coverage ratio threshold
@@ -39,8 +40,8 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
     }
 
     if (cfg.cov_thr >= 0.) {
-        if (cfg.coverage.empty()) {
-            std::cerr << "Provide --coverage file\n";
+        if (!cfg.has_coverage()) {
+            std::cerr << "Provide --coverage file or --coverage-tag\n";
             exit(2);
         }
     }
@@ -50,22 +51,22 @@ int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
-    std::unique_ptr<utils::SegmentCoverageMap> read_cnt_ptr;
-    if (!cfg.read_cnt_file.empty()) {
-        std::cout << "Reading read counts from " << cfg.read_cnt_file << std::endl;
-        read_cnt_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.read_cnt_file));
-    }
-
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
+
+    //indexed by segment id
+    std::vector<double> read_cnts;
+    if (!cfg.read_cnt_file.empty()) {
+        std::cout << "Reading read counts from " << cfg.read_cnt_file << std::endl;
+        if (!gfa::io::ReadSegmentValues(cfg.read_cnt_file, g.get(), read_cnts, cfg.threads)) {
+            std::cerr << "Failed to read read counts from " << cfg.read_cnt_file << std::endl;
+            exit(2);
+        }
+    }
 
     size_t ndel = 0;
 
@@ -110,7 +111,8 @@ int main(int argc, char *argv[]) {
         }
 
         if (!cfg.read_cnt_file.empty() && cfg.max_read_cnt < uint32_t(-1)) {
-            uint32_t read_cnt = utils::get(*read_cnt_ptr, g.segment_name(v));
+            assert(!std::isnan(read_cnts[v.segment_id]));
+            uint32_t read_cnt = uint32_t(read_cnts[v.segment_id]);
             if (read_cnt > cfg.max_read_cnt) {
                 DEBUG("Segment " << g.str(v) << " consisting of too many backbone reads: " << read_cnt);
                 return false;
@@ -125,7 +127,7 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        if (cfg.cov_thr >= 0. && utils::get(*segment_cov_ptr, g.segment_name(v)) >= cfg.cov_thr) {
+        if (cfg.cov_thr >= 0. && g.coverage(v) >= cfg.cov_thr) {
             DEBUG("Coverage of segment " << g.str(v) << " exceeded upper bound");
             return false;
         }
@@ -143,6 +145,6 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    tooling::OutputGraph(g, cfg, ndel, segment_cov_ptr.get());
+    tooling::OutputGraph(g, cfg, ndel);
     std::cout << "END" << std::endl;
 }
@@ -0,0 +1,148 @@
+#include "tokenizer.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TOKENIZER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace utils {
+namespace tokenizer {
+
+namespace {
+
+//All searches are reduced to looking for any of 4 bytes (repeated if fewer are needed)
+const char *FindAnyScalar(const char *b, const char *e, char c1, char c2, char c3, char c4) {
+    for (; b != e; ++b) {
+        char c = *b;
+        if (c == c1 || c == c2 || c == c3 || c == c4)
+            return b;
+    }
+    return e;
+}
+
+#ifdef TOKENIZER_X86
+
+//16-byte compares are plain SSE2, but the whole path is only enabled together with SSE4.2
+__attribute__((target("sse4.2")))
+const char *FindAnySse42(const char *b, const char *e, char c1, char c2, char c3, char c4) {
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+    const __m128i v3 = _mm_set1_epi8(c3);
+    const __m128i v4 = _mm_set1_epi8(c4);
+    for (; e - b >= 16; b += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) b);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, v1), _mm_cmpeq_epi8(x, v2)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(x, v3), _mm_cmpeq_epi8(x, v4)));
+        unsigned mask = _mm_movemask_epi8(m);
+        if (mask)
+            return b + __builtin_ctz(mask);
+    }
+    return FindAnyScalar(b, e, c1, c2, c3, c4);
+}
+
+__attribute__((target("avx2")))
+const char *FindAnyAvx2(const char *b, const char *e, char c1, char c2, char c3, char c4) {
+    const __m256i v1 = _mm256_set1_epi8(c1);
+    const __m256i v2 = _mm256_set1_epi8(c2);
+    const __m256i v3 = _mm256_set1_epi8(c3);
+    const __m256i v4 = _mm256_set1_epi8(c4);
+    for (; e - b >= 32; b += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*) b);
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, v1), _mm256_cmpeq_epi8(x, v2)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(x, v3), _mm256_cmpeq_epi8(x, v4)));
+        unsigned mask = _mm256_movemask_epi8(m);
+        if (mask)
+            return b + __builtin_ctz(mask);
+    }
+    return FindAnySse42(b, e, c1, c2, c3, c4);
+}
+
+#endif
+
+typedef const char *(*FindAnyF)(const char *, const char *, char, char, char, char);
+
+Level DetectLevel() {
+#ifdef TOKENIZER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Level::AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return Level::SSE42;
+#endif
+    return Level::SCALAR;
+}
+
+FindAnyF Implementation(Level level) {
+    switch (level) {
+#ifdef TOKENIZER_X86
+        case Level::AVX2: return FindAnyAvx2;
+        case Level::SSE42: return FindAnySse42;
+#endif
+        default: return FindAnyScalar;
+    }
+}
+
+const Level best_level = DetectLevel();
+Level current_level = best_level;
+FindAnyF find_any = Implementation(best_level);
+
+}
+
+Level BestLevel() {
+    return best_level;
+}
+
+Level CurrentLevel() {
+    return current_level;
+}
+
+void SetLevel(Level level) {
+    assert(level <= best_level);
+    current_level = level;
+    find_any = Implementation(level);
+}
+
+const char *LevelName(Level level) {
+    switch (level) {
+        case Level::AVX2: return "avx2";
+        case Level::SSE42: return "sse4.2";
+        default: return "scalar";
+    }
+}
+
+const char *FindChar(const char *b, const char *e, char c) {
+    return find_any(b, e, c, c, c, c);
+}
+
+const char *FindEither(const char *b, const char *e, char c1, char c2) {
+    return find_any(b, e, c1, c2, c2, c2);
+}
+
+const char *FindSpace(const char *b, const char *e) {
+    return find_any(b, e, ' ', '\t', '\r', '\n');
+}
+
+const char *SplitLine(const char *b, const char *e, char sep,
+                      Token *fields, size_t max_cnt, size_t &cnt) {
+    assert(max_cnt > 0);
+    cnt = 0;
+    while (true) {
+        fields[cnt].b = b;
+        if (cnt + 1 == max_cnt) {
+            const char *line_end = FindChar(b, e, '\n');
+            fields[cnt++].e = line_end;
+            return line_end;
+        }
+        const char *p = FindEither(b, e, sep, '\n');
+        fields[cnt++].e = p;
+        if (p == e || *p == '\n')
+            return p;
+        b = p + 1;
+    }
+}
+
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+
+namespace utils {
+namespace tokenizer {
+
+//Vectorized scanning of delimited text (GFA lines, coverage tables)
+//Implementation is picked at runtime based on CPU support
+enum class Level {
+    SCALAR,
+    SSE42,
+    AVX2
+};
+
+//Best level supported by the CPU
+Level BestLevel();
+
+//Currently used level (BestLevel by default)
+Level CurrentLevel();
+
+//Only intended for benchmarking, not thread-safe
+void SetLevel(Level level);
+
+const char *LevelName(Level level);
+
+//Position of the first occurrence of c in [b, e) or e if absent
+const char *FindChar(const char *b, const char *e, char c);
+
+//Position of the first occurrence of either c1 or c2 in [b, e) or e if absent
+const char *FindEither(const char *b, const char *e, char c1, char c2);
+
+//Position of the first whitespace (' ', '\t', '\r', '\n') in [b, e) or e if absent
+const char *FindSpace(const char *b, const char *e);
+
+//Position of the first non-whitespace character in [b, e) or e if absent
+inline const char *SkipSpace(const char *b, const char *e) {
+    while (b != e && (*b == ' ' || *b == '\t' || *b == '\r' || *b == '\n'))
+        ++b;
+    return b;
+}
+
+struct Token {
+    const char *b;
+    const char *e;
+
+    size_t size() const { return e - b; }
+};
+
+//Splits the line starting at b into at most max_cnt sep-separated fields,
+//the last one spanning till the end of the line.
+//Returns the end of the line (position of '\n' or e), every byte is looked at once.
+const char *SplitLine(const char *b, const char *e, char sep,
+                      Token *fields, size_t max_cnt, size_t &cnt);
+
+}
+}
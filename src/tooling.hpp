@@ -16,6 +16,9 @@ struct cmd_cfg_base {
     //optional file with coverage
     std::string coverage;
 
+    //optional S-line tag to take coverage from (used if no coverage file is provided)
+    std::string coverage_tag;
+
     //compact the graph after cleaning
     bool compact = false;
 
@@ -33,21 +36,38 @@ struct cmd_cfg_base {
 
     //DBG vertex size, enables DBG mode of coverage transformation
     int32_t dbg_k = 0;
+
+    //compress output GFA with BGZF
+    bool compress_out = false;
+
+    //number of threads
+    unsigned threads = 1;
+
+    //optional segment renumbering applied after loading (bfs or rcm)
+    std::string reorder;
+
+    bool has_coverage() const {
+        return !coverage.empty() || !coverage_tag.empty();
+    }
 };
 
 inline
 clipp::group BaseCfg(cmd_cfg_base &cfg) {
     using namespace clipp;
 
-    auto grp = ( cfg.graph_in << value("input file in GFA (ending with .gfa)"),
-            cfg.graph_out << value("output file"),
+    auto grp = ( cfg.graph_in << value("input file in GFA (ending with .gfa) or graph snapshot (.gfab)"),
+            cfg.graph_out << value("output file (graph snapshot is written if ending with .gfab)"),
             (option("--coverage") & value("file", cfg.coverage)) % "file with coverage information",
+            (option("--coverage-tag") & value("tag", cfg.coverage_tag)) % "S-line tag with coverage information: ll, dp, etc. or KC, RC (counts divided by segment length); for snapshots any tag selects the stored coverage",
             option("--compact").set(cfg.compact) % "compact the graph after cleaning (default: false)",
             (option("--id-mapping") & value("file", cfg.id_mapping)) % "file with compacted segment id mapping",
             (option("--prefix") & value("vale", cfg.compacted_prefix)) % "prefix used to form compacted segment names (default: m_, use _ for empty)",
             option("--drop-sequence").set(cfg.drop_sequence) % "flag to drop sequences even if present in original file (default: false)",
             option("--rename-all").set(cfg.rename_all) % "flag to rename all segments. Enforces compaction (default: false)",
-            (option("--dbg-k") & integer("value", cfg.dbg_k)) % "DBG k-mer length to use in coverage transformation (default: 0 -- disabled)"
+            (option("--dbg-k") & integer("value", cfg.dbg_k)) % "DBG k-mer length to use in coverage transformation (default: 0 -- disabled)",
+            option("-z", "--compress").set(cfg.compress_out) % "compress output GFA with BGZF, enabled automatically for .gz output (default: false)",
+            (option("-t", "--threads") & integer("value", cfg.threads)) % "number of threads used for graph loading and output compression (default: 1)",
+            (option("--reorder") & value("method", cfg.reorder)) % "renumber segments to improve memory locality: bfs or rcm (results and output are not affected)"
     ) % "common settings";
 
     if (cfg.compact) {
@@ -56,10 +76,85 @@ clipp::group BaseCfg(cmd_cfg_base &cfg) {
     return grp;
 }
 
+//Cleaning procedures never look at sequences, they are only needed for the output
+//unless S-lines are going to be copied from the input
+inline gfa::SequenceMode RequiredSequenceMode(const cmd_cfg_base &cfg) {
+    if (cfg.drop_sequence)
+        return gfa::SequenceMode::SKIP;
+    //compacted segments are assembled from (packed) segment sequences
+    if (cfg.compact || cfg.rename_all)
+        return gfa::SequenceMode::PACKED;
+    //snapshots are formed from the loaded sequences,
+    //input can't be copied into itself (whatever the spelling of the output path)
+    if (gfa::io::IsSnapshotFilename(cfg.graph_out) ||
+           cfg.graph_in == cfg.graph_out ||
+           gfa::io::SameFile(cfg.graph_in, cfg.graph_out) ||
+           !gfa::io::PassthroughPossible(cfg.graph_in))
+        return gfa::SequenceMode::RAW;
+    return gfa::SequenceMode::SKIP;
+}
+
+//Loads the graph in the required sequence mode (see RequiredSequenceMode).
+//If S-lines turn out not to be copyable (e.g. some segments only appear in L-lines),
+//the graph is reloaded with sequences
+inline void OpenGraph(gfa::Graph &g, const cmd_cfg_base &cfg) {
+    const gfa::SequenceMode mode = RequiredSequenceMode(cfg);
+    if (!g.open(cfg.graph_in, cfg.threads, mode, cfg.coverage_tag)) {
+        std::cerr << "Failed to load graph from " << cfg.graph_in << std::endl;
+        exit(2);
+    }
+    if (mode == gfa::SequenceMode::SKIP && !cfg.drop_sequence && !g.passthrough_output(cfg.graph_out)) {
+        std::cout << "Segments can't be copied from the input, reloading graph with sequences" << std::endl;
+        if (!g.open(cfg.graph_in, cfg.threads, gfa::SequenceMode::RAW, cfg.coverage_tag)) {
+            std::cerr << "Failed to load graph from " << cfg.graph_in << std::endl;
+            exit(2);
+        }
+    }
+}
+
+//Coverage from --coverage file replaces the one taken from S-line tags or stored in the snapshot.
+//Coverage is only used when requested: without --coverage/--coverage-tag the one stored in
+//the snapshot is dropped, so that g.has_coverage() never holds without cfg.has_coverage()
+inline void LoadCoverage(gfa::Graph &g, const cmd_cfg_base &cfg) {
+    if (!cfg.coverage.empty()) {
+        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
+        if (!g.LoadCoverage(cfg.coverage, cfg.threads)) {
+            std::cerr << "Failed to read coverage from " << cfg.coverage << std::endl;
+            exit(2);
+        }
+    } else if (!cfg.coverage_tag.empty()) {
+        const auto &coverage = g.coverage();
+        size_t missing = std::count_if(coverage.begin(), coverage.end(), [](double c) { return std::isnan(c); });
+        if (coverage.empty() || missing == coverage.size()) {
+            std::cerr << "No segments with coverage tag " << cfg.coverage_tag << std::endl;
+            exit(2);
+        }
+        if (missing > 0)
+            WARN(missing << " segments lack coverage tag " << cfg.coverage_tag);
+    } else if (g.has_coverage()) {
+        INFO("Ignoring coverage stored in " << cfg.graph_in << " (use --coverage-tag to keep it)");
+        g.set_coverage({});
+    }
+    assert(!g.has_coverage() || cfg.has_coverage());
+}
+
+//Renumbers segments of the loaded graph if requested with --reorder
+inline void ReorderSegments(gfa::Graph &g, const cmd_cfg_base &cfg) {
+    if (cfg.reorder.empty())
+        return;
+    gfa::SegmentOrder order;
+    if (!gfa::ParseSegmentOrder(cfg.reorder, order)) {
+        std::cerr << "Unknown segment order " << cfg.reorder << std::endl;
+        exit(1);
+    }
+    std::cout << "Reordering segments (" << cfg.reorder << ")" << std::endl;
+    g.Reorder(order);
+}
+
+//Coverage of the graph (if available) is used for compacted segments and stored in snapshots
 void OutputGraph(gfa::Graph &g,
                  const cmd_cfg_base &cfg,
-                 size_t ndel = size_t(-1),
-                 const utils::SegmentCoverageMap *segment_cov_ptr = nullptr) {
+                 size_t ndel = size_t(-1)) {
     if (ndel != size_t(-1))
         std::cout << "Triggered " << ndel << " times" << std::endl;
 
@@ -70,13 +165,32 @@ void OutputGraph(gfa::Graph &g,
 
     assert(g.CheckNoDeadLinks());
 
+    const bool snapshot_out = gfa::io::IsSnapshotFilename(cfg.graph_out);
+    const bool compress_out = gfa::io::CompressedOutput(cfg.graph_out, cfg.compress_out);
+
     if (cfg.rename_all || (ndel > 0 && cfg.compact)) {
-        gfa::Compactifier compactifier(g, cfg.compacted_prefix, segment_cov_ptr, cfg.dbg_k);
+        gfa::Compactifier compactifier(g, cfg.compacted_prefix, g.has_coverage(), cfg.dbg_k);
         std::cout << "Writing compacted graph to " << cfg.graph_out << std::endl;
-        compactifier.Compact(cfg.graph_out, cfg.id_mapping, cfg.drop_sequence, cfg.rename_all);
+        if (snapshot_out) {
+            gfa::Graph compacted;
+            compactifier.Compact(compacted, cfg.id_mapping, cfg.drop_sequence, cfg.rename_all);
+            if (!compacted.write(cfg.graph_out, cfg.drop_sequence)) {
+                std::cerr << "Failed to write graph to " << cfg.graph_out << std::endl;
+                exit(3);
+            }
+        } else {
+            if (!compactifier.Compact(cfg.graph_out, cfg.id_mapping, cfg.drop_sequence, cfg.rename_all,
+                                      compress_out, cfg.threads)) {
+                std::cerr << "Failed to write graph to " << cfg.graph_out << std::endl;
+                exit(3);
+            }
+        }
     } else {
         std::cout << "Writing output to " << cfg.graph_out << std::endl;
-        g.write(cfg.graph_out, cfg.drop_sequence);
+        if (!g.write(cfg.graph_out, cfg.drop_sequence, compress_out, cfg.threads)) {
+            std::cerr << "Failed to write graph to " << cfg.graph_out << std::endl;
+            exit(3);
+        }
     }
 
     std::cout << "Writing complete" << std::endl;
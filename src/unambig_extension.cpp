@@ -8,10 +8,12 @@ int main(int argc, char *argv[]) {
     using namespace clipp;
     std::string graph_in;
     std::string fasta_out;
+    unsigned threads = 1;
 
     auto cli = (
             graph_in << value("input file in GFA (ending with .gfa)"),
-            fasta_out << value("output file")
+            fasta_out << value("output file"),
+            (option("-t", "--threads") & integer("value", threads)) % "number of threads used for graph loading (default: 1)"
     );
 
     auto result = parse(argc, argv, cli);
@@ -24,7 +26,7 @@ int main(int argc, char *argv[]) {
 
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << graph_in << std::endl;
-    g.open(graph_in);
+    g.open(graph_in, threads, gfa::SequenceMode::PACKED);
 
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
 
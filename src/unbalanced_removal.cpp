@@ -17,7 +17,7 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
     ) % "algorithm settings");
 
     auto result = parse(argc, argv, cli);
-    assert(!cfg.coverage.empty());
+    assert(cfg.has_coverage());
     if (!result) {
         std::cerr << make_man_page(cli, argv[0]);
         exit(1);
@@ -25,7 +25,6 @@ static void process_cmdline(int argc, char **argv, cmd_cfg &cfg) {
 }
 
 //TODO consider making iterative right here after I can compress and track reads here
-//TODO put coverage into GFA (check support in parcer, etc)
 int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
@@ -33,13 +32,13 @@ int main(int argc, char *argv[]) {
     assert(cfg.coverage_ratio <= 1.);
     std::cout << "Removing links with node coverage ratio less than " << cfg.coverage_ratio << std::endl;
 
-    std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-    const auto segment_cov = utils::ReadCoverage(cfg.coverage);
 
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     size_t ndel = 0;
     for (gfa::DirectedSegment ds : g.directed_segments()) {
@@ -54,17 +53,15 @@ int main(int argc, char *argv[]) {
             //std::cerr << "Use overlap " << ovl << std::endl;
             //std::cout << "Checking name " << g.segment(l.end.segment_id).name << std::endl;
             assert(l.start == ds);
-            assert(segment_cov.find(g.segment_name(l.end)) != segment_cov.end());
-
-            auto nb_cov = segment_cov.find(g.segment_name(l.end))->second;
+            auto nb_cov = g.coverage(l.end);
             if (nb_cov > max_onb_cov)
                 max_onb_cov = nb_cov;
         }
 
-        uint32_t baseline_cov = utils::get(segment_cov, g.segment_name(ds));
+        uint32_t baseline_cov = g.coverage(ds);
 
         for (gfa::LinkInfo l : g.outgoing_links(ds)) {
-            auto nb_cov = utils::get(segment_cov, g.segment_name(l.end));
+            auto nb_cov = g.coverage(l.end);
             if (double(nb_cov) / baseline_cov > cfg.coverage_ratio - 1e-5)
                 continue;
 
@@ -81,6 +78,6 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    tooling::OutputGraph(g, cfg, ndel, &segment_cov);
+    tooling::OutputGraph(g, cfg, ndel);
     std::cout << "END" << std::endl;
 }
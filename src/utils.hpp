@@ -2,9 +2,21 @@
 
 #include <cassert>
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <charconv>
+#include <iterator>
+#include <type_traits>
+
+#include "tokenizer.hpp"
 
 //#define DEBUG_LOGGING 1
 //#define TRACE_LOGGING 1
@@ -73,8 +85,316 @@ public:
     It end() const {
         return end_;
     }
+
+    //random-access iterators only
+    size_t size() const {
+        return size_t(end_ - begin_);
+    }
+
+    auto operator[](size_t i) const {
+        return begin_[i];
+    }
+};
+
+//Base of random-access iterators over positions of an indexed source (see CRTP),
+//Derived::at(pos) provides elements by value, only iterators over the same source are comparable
+template<class Derived, class T>
+class PositionIterator {
+    ptrdiff_t pos_;
+
+    const Derived &self() const {
+        return static_cast<const Derived&>(*this);
+    }
+
+    Derived &self() {
+        return static_cast<Derived&>(*this);
+    }
+
+protected:
+    explicit PositionIterator(ptrdiff_t pos = 0): pos_(pos) {}
+
+public:
+    // iterator traits
+    using difference_type = ptrdiff_t;
+    using value_type = T;
+    using pointer = const T*;
+    using reference = T;
+    using iterator_category = std::random_access_iterator_tag;
+
+    ptrdiff_t position() const {
+        return pos_;
+    }
+
+    T operator*() const {
+        return self().at(pos_);
+    }
+
+    T operator[](ptrdiff_t n) const {
+        return self().at(pos_ + n);
+    }
+
+    Derived& operator++() {
+        ++pos_;
+        return self();
+    }
+
+    Derived operator++(int) {
+        Derived retval = self();
+        ++pos_;
+        return retval;
+    }
+
+    Derived& operator--() {
+        --pos_;
+        return self();
+    }
+
+    Derived operator--(int) {
+        Derived retval = self();
+        --pos_;
+        return retval;
+    }
+
+    Derived& operator+=(ptrdiff_t n) {
+        pos_ += n;
+        return self();
+    }
+
+    Derived& operator-=(ptrdiff_t n) {
+        pos_ -= n;
+        return self();
+    }
+
+    friend Derived operator+(Derived it, ptrdiff_t n) {
+        return it += n;
+    }
+
+    friend Derived operator+(ptrdiff_t n, Derived it) {
+        return it += n;
+    }
+
+    friend Derived operator-(Derived it, ptrdiff_t n) {
+        return it -= n;
+    }
+
+    friend ptrdiff_t operator-(const Derived &a, const Derived &b) {
+        return a.position() - b.position();
+    }
+
+    friend bool operator==(const Derived &a, const Derived &b) {
+        return a.position() == b.position();
+    }
+
+    friend bool operator!=(const Derived &a, const Derived &b) {
+        return a.position() != b.position();
+    }
+
+    friend bool operator<(const Derived &a, const Derived &b) {
+        return a.position() < b.position();
+    }
+
+    friend bool operator>(const Derived &a, const Derived &b) {
+        return a.position() > b.position();
+    }
+
+    friend bool operator<=(const Derived &a, const Derived &b) {
+        return a.position() <= b.position();
+    }
+
+    friend bool operator>=(const Derived &a, const Derived &b) {
+        return a.position() >= b.position();
+    }
+};
+
+//Dense containers below are indexed by DenseIndex(key), which is found via ADL,
+//so that key types from other namespaces (e.g. gfa::DirectedSegment) can provide their own
+template<class T>
+size_t DenseIndex(T key) {
+    return size_t(key);
+}
+
+//Set of keys with indices in [0, capacity) stored as a bitset (no iteration)
+template<class Key>
+class DenseSet {
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+
+public:
+    explicit DenseSet(size_t capacity = 0): words_((capacity + 63) / 64, 0) {}
+
+    //returns true if the key was not present
+    bool insert(Key key) {
+        const size_t i = DenseIndex(key);
+        assert(i / 64 < words_.size());
+        const uint64_t mask = uint64_t(1) << (i % 64);
+        if (words_[i / 64] & mask)
+            return false;
+        words_[i / 64] |= mask;
+        ++size_;
+        return true;
+    }
+
+    size_t erase(Key key) {
+        const size_t i = DenseIndex(key);
+        assert(i / 64 < words_.size());
+        const uint64_t mask = uint64_t(1) << (i % 64);
+        if (!(words_[i / 64] & mask))
+            return 0;
+        words_[i / 64] &= ~mask;
+        --size_;
+        return 1;
+    }
+
+    size_t count(Key key) const {
+        const size_t i = DenseIndex(key);
+        assert(i / 64 < words_.size());
+        return words_[i / 64] >> (i % 64) & 1;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    void clear() {
+        std::fill(words_.begin(), words_.end(), 0);
+        size_ = 0;
+    }
+};
+
+//Value per key with index in [0, capacity), keys never assigned hold the default value
+template<class Key, class T>
+class PropertyVector {
+    std::vector<T> values_;
+
+public:
+    explicit PropertyVector(size_t capacity = 0, const T &default_value = T()):
+        values_(capacity, default_value) {}
+
+    T &operator[](Key key) {
+        assert(DenseIndex(key) < values_.size());
+        return values_[DenseIndex(key)];
+    }
+
+    const T &operator[](Key key) const {
+        assert(DenseIndex(key) < values_.size());
+        return values_[DenseIndex(key)];
+    }
+
+    size_t capacity() const {
+        return values_.size();
+    }
+};
+
+//Set of keys with indices in [0, capacity) for repeated searches:
+//every key is stamped with the current epoch, so clear() just starts a new one
+template<class Key>
+class VisitedSet {
+    std::vector<uint32_t> stamps_;
+    uint32_t epoch_ = 1;
+
+public:
+    explicit VisitedSet(size_t capacity = 0): stamps_(capacity, 0) {}
+
+    //returns true if the key was not present
+    bool insert(Key key) {
+        const size_t i = DenseIndex(key);
+        assert(i < stamps_.size());
+        if (stamps_[i] == epoch_)
+            return false;
+        stamps_[i] = epoch_;
+        return true;
+    }
+
+    size_t count(Key key) const {
+        const size_t i = DenseIndex(key);
+        assert(i < stamps_.size());
+        return stamps_[i] == epoch_;
+    }
+
+    //O(1) apart from the stamps being wiped once in 2^32 - 1 calls
+    void clear() {
+        if (++epoch_ == 0) {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            epoch_ = 1;
+        }
+    }
 };
 
+//Calls task(i) for each i in [0, task_cnt) using up to thread_cnt threads
+//Tasks are handed out in order, so ranges of similar cost balance well
+inline void RunInParallel(size_t task_cnt, unsigned thread_cnt,
+                          const std::function<void (size_t)> &task) {
+    thread_cnt = std::max(1u, std::min(thread_cnt, unsigned(task_cnt)));
+    if (thread_cnt <= 1) {
+        for (size_t i = 0; i < task_cnt; ++i)
+            task(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < task_cnt; i = next++)
+            task(i);
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(thread_cnt - 1);
+    for (unsigned t = 1; t < thread_cnt; ++t)
+        workers.emplace_back(worker);
+    worker();
+    for (auto &w : workers)
+        w.join();
+}
+
+//Elements per task of the parallel loops below
+const size_t PARALLEL_CHUNK_SIZE = 1 << 12;
+
+//Calls f(chunk_id, chunk) for consecutive chunks (ProxyContainer) of chunk_size elements
+//of a random-access range using up to thread_cnt threads, chunk ids follow the range order
+template<class Range, class F>
+void ParallelForChunks(const Range &range, unsigned thread_cnt, F f,
+                       size_t chunk_size = PARALLEL_CHUNK_SIZE) {
+    const auto begin = range.begin();
+    const size_t size = size_t(range.end() - begin);
+    RunInParallel((size + chunk_size - 1) / chunk_size, thread_cnt, [&](size_t i) {
+        const auto b = begin + ptrdiff_t(i * chunk_size);
+        const auto e = begin + ptrdiff_t(std::min(size, (i + 1) * chunk_size));
+        f(i, ProxyContainer<std::decay_t<decltype(b)>>(b, e));
+    });
+}
+
+//Calls f(element) for every element of a random-access range using up to thread_cnt threads
+template<class Range, class F>
+void ParallelForEach(const Range &range, unsigned thread_cnt, F f,
+                     size_t chunk_size = PARALLEL_CHUNK_SIZE) {
+    ParallelForChunks(range, thread_cnt, [&](size_t, const auto &chunk) {
+        for (auto &&x : chunk)
+            f(x);
+    }, chunk_size);
+}
+
+//Elements of a random-access range satisfying pred (in the range order), pred is evaluated by up to thread_cnt threads
+template<class Range, class Pred>
+auto ParallelFilter(const Range &range, unsigned thread_cnt, Pred pred,
+                    size_t chunk_size = PARALLEL_CHUNK_SIZE) {
+    typedef typename std::iterator_traits<std::decay_t<decltype(range.begin())>>::value_type T;
+    std::vector<std::vector<T>> chunk_answers((size_t(range.end() - range.begin()) + chunk_size - 1) / chunk_size);
+    ParallelForChunks(range, thread_cnt, [&](size_t i, const auto &chunk) {
+        for (auto &&x : chunk)
+            if (pred(x))
+                chunk_answers[i].push_back(x);
+    }, chunk_size);
+
+    std::vector<T> answer;
+    for (const auto &chunk_answer : chunk_answers)
+        answer.insert(answer.end(), chunk_answer.begin(), chunk_answer.end());
+    return answer;
+}
+
 template<class Vec>
 void ReadVec(const std::string &fn, Vec &vec) {
     std::string seg_name;
@@ -99,20 +419,78 @@ void ReadSet(const std::string &fn, Set &set) {
     }
 }
 
+inline bool ReadFile(const std::string &fn, std::string &content) {
+    std::ifstream is(fn, std::ios::binary);
+    if (!is)
+        return false;
+    is.seekg(0, std::ios::end);
+    content.resize(size_t(is.tellg()));
+    is.seekg(0, std::ios::beg);
+    is.read(&content[0], content.size());
+    return bool(is);
+}
+
+//Whole token [b, e) has to be consumed.
+//Integral values are parsed with from_chars, other types fall back to stream extraction
+template<class T>
+bool ParseValue(const char *b, const char *e, T &val) {
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        //stream extraction accepted explicit '+'
+        if (e - b > 1 && *b == '+' && *(b + 1) != '-')
+            ++b;
+        auto res = std::from_chars(b, e, val);
+        return b != e && res.ptr == e && res.ec == std::errc();
+    } else {
+        std::istringstream ss(std::string(b, e));
+        return bool(ss >> val) && ss.peek() == EOF;
+    }
+}
+
+inline bool ParseValue(const char *b, const char *e, double &val) {
+    auto res = std::from_chars(b, e, val);
+    return b != e && res.ptr == e && res.ec == std::errc();
+}
+
 template<class Map>
 void ReadMap(const std::string &fn, Map &map) {
-    std::string seg_name;
-    typename Map::mapped_type val;
+    using namespace tokenizer;
+    std::string content;
+    if (!ReadFile(fn, content))
+        return;
 
-    std::ifstream is(fn);
-
-    while (is >> seg_name >> val) {
-        map[seg_name] = val;
+    typename Map::mapped_type val;
+    const char *e = content.data() + content.size();
+    const char *p = content.data();
+    while (true) {
+        const char *key_b = SkipSpace(p, e);
+        const char *key_e = FindSpace(key_b, e);
+        const char *val_b = SkipSpace(key_e, e);
+        const char *val_e = FindSpace(val_b, e);
+        if (val_b == e || !ParseValue(val_b, val_e, val))
+            break;
 
+        std::string seg_name(key_b, key_e);
         TRACE("Populating map with '" << seg_name << "' and " << val);
+        map[std::move(seg_name)] = val;
+        p = val_e;
     }
 }
 
+//Appends decimal representation of an integer
+template<class T>
+void AppendInt(std::string &out, T val) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), val);
+    out.append(buf, res.ptr);
+}
+
+//Same formatting as default std::ostream output of a double
+inline void AppendDouble(std::string &out, double val) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "%g", val);
+    out.append(buf, n);
+}
+
 typedef std::unordered_map<std::string, double> SegmentCoverageMap;
 
 inline
@@ -39,21 +39,16 @@ inline bool CheckHasStrongIncoming(const gfa::Graph &g, gfa::DirectedSegment v,
 }
 
 //TODO consider making iterative right here after I can compress and track reads here
-//TODO put coverage into GFA (check support in parser, etc)
 int main(int argc, char *argv[]) {
     cmd_cfg cfg;
     process_cmdline(argc, argv, cfg);
 
-    std::unique_ptr<utils::SegmentCoverageMap> segment_cov_ptr;
-    if (!cfg.coverage.empty()) {
-        std::cout << "Reading coverage from " << cfg.coverage << std::endl;
-        segment_cov_ptr = std::make_unique<utils::SegmentCoverageMap>(utils::ReadCoverage(cfg.coverage));
-    }
-
     gfa::Graph g;
     std::cout << "Loading graph from GFA file " << cfg.graph_in << std::endl;
-    g.open(cfg.graph_in);
+    tooling::OpenGraph(g, cfg);
     std::cout << "Segment cnt: " << g.segment_cnt() << "; link cnt: " << g.link_cnt() << std::endl;
+    tooling::LoadCoverage(g, cfg);
+    tooling::ReorderSegments(g, cfg);
 
     size_t ndel = 0;
     for (gfa::DirectedSegment ds : g.directed_segments()) {
@@ -93,6 +88,6 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    tooling::OutputGraph(g, cfg, ndel, segment_cov_ptr.get());
+    tooling::OutputGraph(g, cfg, ndel);
     std::cout << "END" << std::endl;
 }
@@ -1,11 +1,483 @@
 #include "wrapper.hpp"
 #include "gfa-priv.h"
+#include "khash.h"
+
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+//same as the segment name hash of gfatools
+KHASH_MAP_INIT_STR(seg, uint32_t)
 
 namespace gfa {
 
+void Graph::Reset(gfa_t *g, std::shared_ptr<io::MappedFile> mapping, std::unique_ptr<utils::Arena> arena) {
+    if (g_ptr_ && mapping_) {
+        for (uint32_t i = 0; i < g_ptr_->n_seg; ++i) {
+            gfa_seg_t &s = g_ptr_->seg[i];
+            if (mapping_->contains(s.seq))
+                s.seq = nullptr;
+        }
+    }
+    if (g_ptr_ && arena_)
+        io::DetachArena(get(), *arena_);
+    g_ptr_.reset(g);
+    mapping_ = std::move(mapping);
+    arena_ = std::move(arena);
+    coverage_.clear();
+    lines_.reset();
+    packed_.reset();
+    sequences_skipped_ = false;
+    dual_arcs_.clear();
+    unpaired_arcs_ = false;
+    cleanup_needed_ = false;
+    input_order_.clear();
+    input_pos_.clear();
+    CountLiveDegrees();
+}
+
+void Graph::CountLiveDegrees() {
+    live_degree_.clear();
+    if (!g_ptr_)
+        return;
+    const gfa_t *g = get();
+    live_degree_.assign(gfa_n_vtx(g), 0);
+    for (uint64_t k = 0; k < g->n_arc; ++k)
+        live_degree_[g->arc[k].v_lv >> 32] += !g->arc[k].del;
+}
+
+void Graph::DeleteArc(uint64_t k) {
+    if (dual_arcs_.empty())
+        IndexDualArcs();
+    cleanup_needed_ = true;
+    gfa_t *g = get();
+    for (uint64_t i : {k, dual_arcs_[k]}) {
+        gfa_arc_t &a = g->arc[i];
+        if (!a.del) {
+            a.del = 1;
+            --live_degree_[a.v_lv >> 32];
+        }
+    }
+}
+
+void Graph::DeleteLink(DirectedSegment v, DirectedSegment w) {
+    const InnerVertexId inner_v = v.AsInnerVertexT();
+    const uint64_t start = gfa_arc_a(get(), inner_v) - get()->arc;
+    for (uint64_t k = start; k < start + gfa_arc_n(get(), inner_v); ++k)
+        if (get()->arc[k].w == w.AsInnerVertexT())
+            DeleteArc(k);
+}
+
+void Graph::DeleteSegment(SegmentId segment_id) {
+    get()->seg[segment_id].del = 1;
+    cleanup_needed_ = true;
+    for (InnerVertexId inner_v : {InnerVertexId(segment_id) << 1, InnerVertexId(segment_id) << 1 | 1}) {
+        const uint64_t start = gfa_arc_a(get(), inner_v) - get()->arc;
+        for (uint64_t k = start; k < start + gfa_arc_n(get(), inner_v); ++k)
+            DeleteArc(k);
+    }
+}
+
+bool Graph::IsDualArc(uint64_t k, uint64_t d) const {
+    const gfa_arc_t &a = get()->arc[k];
+    const gfa_arc_t &b = get()->arc[d];
+    return (b.v_lv >> 32) == (a.w ^ 1) && b.w == ((a.v_lv >> 32) ^ 1) && b.ov == a.ow && b.ow == a.ov;
+}
+
+uint64_t Graph::FindDualArc(uint64_t k) const {
+    if (!dual_arcs_.empty())
+        return dual_arcs_[k];
+    const gfa_t *g = get();
+    //duplicate links are paired by their ranks among the identical arcs
+    const gfa_arc_t &a = g->arc[k];
+    const uint32_t v = uint32_t(a.v_lv >> 32);
+    size_t rank = 0;
+    for (uint64_t i = gfa_arc_a(g, v) - g->arc; i < k; ++i)
+        rank += g->arc[i].w == a.w && g->arc[i].ov == a.ov && g->arc[i].ow == a.ow;
+
+    const uint32_t u = a.w ^ 1;
+    const uint64_t start = gfa_arc_a(g, u) - g->arc;
+    for (uint64_t d = start; d < start + gfa_arc_n(g, u); ++d)
+        if (IsDualArc(k, d) && rank-- == 0)
+            return d;
+    //overlaps of the explicitly given dual might disagree, matching the ends only (same as gfatools)
+    for (uint64_t d = start; d < start + gfa_arc_n(g, u); ++d)
+        if (g->arc[d].w == (v ^ 1))
+            return d;
+    return k;
+}
+
+std::vector<uint64_t> Graph::DualArcIndex() const {
+    if (!dual_arcs_.empty())
+        return dual_arcs_;
+    const gfa_t *g = get();
+
+    std::vector<uint64_t> dual_arcs(g->n_arc, LinkInfo::NO_ARC);
+    //arcs added by gfatools to make the graph symmetric share link_id with the original one
+    uint64_t max_link_id = 0;
+    for (uint64_t k = 0; k < g->n_arc; ++k)
+        max_link_id = std::max(max_link_id, uint64_t(g->arc[k].link_id));
+    std::vector<uint64_t> first_arc(g->n_arc ? max_link_id + 1 : 0, LinkInfo::NO_ARC);
+    for (uint64_t k = 0; k < g->n_arc; ++k) {
+        uint64_t &f = first_arc[g->arc[k].link_id];
+        if (f == LinkInfo::NO_ARC) {
+            f = k;
+        } else if (dual_arcs[f] == LinkInfo::NO_ARC && IsDualArc(k, f)) {
+            dual_arcs[f] = k;
+            dual_arcs[k] = f;
+        }
+    }
+
+    //both arcs were given explicitly (or the link is its own complement), searching for the dual
+    //among the remaining arcs sorted by their ends, so that hub vertices are not scanned per arc
+    std::vector<uint64_t> rest;
+    for (uint64_t k = 0; k < g->n_arc; ++k)
+        if (dual_arcs[k] == LinkInfo::NO_ARC)
+            rest.push_back(k);
+    auto key = [&](uint64_t k) {
+        const gfa_arc_t &a = g->arc[k];
+        return std::make_tuple(uint32_t(a.v_lv >> 32), a.w, a.ov, a.ow, k);
+    };
+    std::sort(rest.begin(), rest.end(), [&](uint64_t k1, uint64_t k2) { return key(k1) < key(k2); });
+    //pairs k with the first remaining arc from the range starting at the lower bound of the dual key
+    auto pair_with = [&](uint64_t k, bool match_overlaps) {
+        const gfa_arc_t &a = g->arc[k];
+        const uint32_t u = a.w ^ 1, x = uint32_t(a.v_lv >> 32) ^ 1;
+        auto it = std::lower_bound(rest.begin(), rest.end(), k, [&](uint64_t d, uint64_t) {
+            return match_overlaps ? key(d) < std::make_tuple(u, x, a.ow, a.ov, uint64_t(0))
+                                  : std::make_pair(uint32_t(g->arc[d].v_lv >> 32), g->arc[d].w) < std::make_pair(u, x);
+        });
+        for (; it != rest.end() && uint32_t(g->arc[*it].v_lv >> 32) == u && g->arc[*it].w == x; ++it) {
+            const uint64_t d = *it;
+            if (match_overlaps && !IsDualArc(k, d))
+                break;
+            if (d == k || dual_arcs[d] == LinkInfo::NO_ARC) {
+                dual_arcs[k] = d;
+                dual_arcs[d] = k;
+                return;
+            }
+        }
+    };
+    for (uint64_t k : rest)
+        if (dual_arcs[k] == LinkInfo::NO_ARC)
+            pair_with(k, true);
+
+    //overlaps of explicitly given duals might disagree, gfatools only matches the ends
+    for (uint64_t k : rest) {
+        if (dual_arcs[k] != LinkInfo::NO_ARC)
+            continue;
+        pair_with(k, false);
+        //asymmetric graph
+        if (dual_arcs[k] == LinkInfo::NO_ARC)
+            dual_arcs[k] = k;
+    }
+    return dual_arcs;
+}
+
+void Graph::IndexDualArcs() {
+    dual_arcs_ = DualArcIndex();
+    //dropped by Cleanup (see gfa_fix_symm_del), unless the link connects a segment end to itself
+    const gfa_t *g = get();
+    for (uint64_t k = 0; k < g->n_arc; ++k)
+        if (dual_arcs_[k] == k && g->arc[k].w != ((g->arc[k].v_lv >> 32) ^ 1))
+            unpaired_arcs_ = true;
+}
+
+void Graph::Renumber(const std::vector<SegmentId> &order) {
+    gfa_t *g = get();
+    const uint32_t n = g->n_seg;
+    assert(order.size() == n);
+    std::vector<SegmentId> new_id(n);
+    for (uint32_t i = 0; i < n; ++i)
+        new_id[order[i]] = i;
+    auto new_v = [&](uint32_t v) { return uint32_t(new_id[v >> 1] << 1 | (v & 1)); };
+
+    std::vector<gfa_seg_t> segs(g->seg, g->seg + n);
+    khash_t(seg) *h = (khash_t(seg)*) g->h_names;
+    for (uint32_t i = 0; i < n; ++i) {
+        g->seg[i] = segs[order[i]];
+        khint_t k = kh_get(seg, h, g->seg[i].name);
+        assert(k != kh_end(h));
+        kh_val(h, k) = i;
+    }
+
+    //arcs stay grouped by source vertex (in the same order within the group), link ids are kept
+    std::vector<gfa_arc_t> arcs;
+    arcs.reserve(g->n_arc);
+    std::vector<uint64_t> idx(gfa_n_vtx(g));
+    for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t v : {uint32_t(order[i] << 1), uint32_t(order[i] << 1 | 1)}) {
+            const gfa_arc_t *av = gfa_arc_a(g, v);
+            const uint32_t nv = gfa_arc_n(g, v);
+            idx[new_v(v)] = uint64_t(arcs.size()) << 32 | nv;
+            for (uint32_t j = 0; j < nv; ++j) {
+                gfa_arc_t a = av[j];
+                a.v_lv = uint64_t(new_v(v)) << 32 | uint32_t(a.v_lv);
+                a.w = new_v(a.w);
+                arcs.push_back(a);
+            }
+        }
+    }
+    assert(arcs.size() == g->n_arc);
+    std::copy(arcs.begin(), arcs.end(), g->arc);
+    std::copy(idx.begin(), idx.end(), g->idx);
+
+    auto permute = [&](auto &values) {
+        if (values.size() != n)
+            return;
+        std::remove_reference_t<decltype(values)> permuted(n);
+        for (uint32_t i = 0; i < n; ++i)
+            permuted[i] = values[order[i]];
+        values = std::move(permuted);
+    };
+    permute(coverage_);
+    if (lines_) {
+        permute(lines_->offsets);
+        permute(lines_->sizes);
+    }
+    if (packed_)
+        packed_->Permute(order);
+
+    dual_arcs_.clear();
+    CountLiveDegrees();
+}
+
+void Graph::Reorder(SegmentOrder method) {
+    if (method == SegmentOrder::INPUT)
+        return;
+    const std::vector<uint32_t> locality_order = LocalityOrder(get(), method);
+    const std::vector<SegmentId> order(locality_order.begin(), locality_order.end());
+    std::vector<SegmentId> new_id(order.size());
+    for (SegmentId i = 0; i < order.size(); ++i)
+        new_id[order[i]] = i;
+    if (input_order_.empty()) {
+        input_order_ = std::move(new_id);
+    } else {
+        for (SegmentId &s : input_order_)
+            s = new_id[s];
+    }
+    input_pos_.resize(input_order_.size());
+    for (SegmentId i = 0; i < input_order_.size(); ++i)
+        input_pos_[input_order_[i]] = i;
+    Renumber(order);
+}
+
+bool Graph::LoadCoverage(const std::string &filename, unsigned thread_cnt) {
+    std::vector<double> coverage;
+    if (!io::ReadSegmentValues(filename, get(), coverage, thread_cnt))
+        return false;
+    coverage_ = std::move(coverage);
+    return true;
+}
+
+void Graph::PackSequences() {
+    if (!packed_)
+        packed_.reset(new PackedSequences());
+    for (uint32_t i = 0; i < g_ptr_->n_seg; ++i) {
+        gfa_seg_t &s = g_ptr_->seg[i];
+        if (!s.seq)
+            continue;
+        packed_->Assign(i, packed_->Pack(s.seq, s.len), s.len);
+        if (!borrowed(s.seq))
+            free(s.seq);
+        s.seq = nullptr;
+    }
+}
+
+void Graph::AppendSequence(DirectedSegment v, size_t trim, std::string &out) const {
+    const gfa_seg_t &s = get()->seg[v.segment_id];
+    if (packed_ && packed_->has_sequence(v.segment_id)) {
+        packed_->Unpack(v.segment_id, v.direction == Direction::REVERSE, trim, out);
+    } else if (s.seq) {
+        assert(trim <= size_t(s.len));
+        if (v.direction == Direction::FORWARD)
+            out.append(s.seq + trim, s.len - trim);
+        else
+            AppendReverseComplement(s.seq, s.len, trim, out);
+    }
+}
+
+bool Graph::open(const std::string &filename, unsigned thread_cnt, SequenceMode mode,
+                 const std::string &coverage_tag) {
+    if (io::IsSnapshot(filename)) {
+        std::shared_ptr<io::MappedFile> mapping;
+        std::vector<double> coverage;
+        gfa_t *g = io::ReadSnapshot(filename, mapping, coverage, mode != SequenceMode::SKIP);
+        Reset(g, std::move(mapping));
+        if (!coverage_tag.empty() && g)
+            WARN("Segment tags are not stored in snapshots, using stored coverage instead of '"
+                         << coverage_tag << "' tag values");
+        coverage_ = std::move(coverage);
+        if (mode == SequenceMode::PACKED && g)
+            PackSequences();
+    } else {
+        auto lines = std::make_shared<io::SegmentLines>();
+        std::unique_ptr<PackedSequences> packed;
+        if (mode == SequenceMode::PACKED)
+            packed.reset(new PackedSequences());
+        std::vector<double> coverage;
+        std::unique_ptr<utils::Arena> arena;
+        if (arena_storage_)
+            arena.reset(new utils::Arena(utils::Arena::DEFAULT_SLAB_SIZE, huge_pages_));
+        gfa_t *g = io::ReadParallel(filename, thread_cnt, mode, lines.get(), packed.get(),
+                                    coverage_tag, &coverage, arena.get());
+        Reset(g, nullptr, std::move(arena));
+        if (!lines->offsets.empty())
+            lines_ = std::move(lines);
+        packed_ = std::move(packed);
+        coverage_ = std::move(coverage);
+    }
+    sequences_skipped_ = (mode == SequenceMode::SKIP);
+    return (bool)g_ptr_;
+}
+
+namespace {
+
+//gfa_print and snapshot writer need packed sequences to be temporarily restored
+class RawSequences {
+    gfa_t *g_;
+    const PackedSequences *packed_;
+
+public:
+    RawSequences(gfa_t *g, const PackedSequences *packed, bool needed):
+            g_(g), packed_(needed ? packed : nullptr) {
+        if (!packed_)
+            return;
+        for (uint32_t i = 0; i < g_->n_seg; ++i) {
+            if (!packed_->has_sequence(i) || g_->seg[i].del)
+                continue;
+            std::string seq = packed_->Sequence(i);
+            g_->seg[i].seq = strdup(seq.c_str());
+        }
+    }
+
+    ~RawSequences() {
+        if (!packed_)
+            return;
+        for (uint32_t i = 0; i < g_->n_seg; ++i) {
+            if (!packed_->has_sequence(i))
+                continue;
+            free(g_->seg[i].seq);
+            g_->seg[i].seq = nullptr;
+        }
+    }
+};
+
+}
+
+bool Graph::write(const std::string &filename, bool drop_sequence,
+                  bool compress, unsigned thread_cnt) {
+    if (reordered()) {
+        //temporarily restoring the input numbering, so that the output is the same
+        //(arcs end up at the same indices, so LinkInfo::arc_id and CsrGraph snapshots stay valid)
+        std::vector<SegmentId> input_order = std::move(input_order_);
+        std::vector<SegmentId> input_pos = std::move(input_pos_);
+        input_order_.clear();
+        input_pos_.clear();
+        Renumber(input_order);
+        bool ok = write(filename, drop_sequence, compress, thread_cnt);
+        Renumber(input_pos);
+        input_order_ = std::move(input_order);
+        input_pos_ = std::move(input_pos);
+        return ok;
+    }
+    //FIXME consider putting Cleanup call here
+    const bool need_passthrough = sequences_skipped_ && !drop_sequence;
+    if (io::IsSnapshotFilename(filename)) {
+        if (need_passthrough) {
+            WARN("Sequences were not loaded, can't write graph snapshot to " << filename);
+            return false;
+        }
+        RawSequences raw(g_ptr_.get(), packed_.get(), !drop_sequence);
+        if (!io::WriteSnapshot(get(), filename, drop_sequence, coverage_)) {
+            WARN("Failed to write graph snapshot to " << filename);
+            return false;
+        }
+        return true;
+    }
+    const bool passthrough = !drop_sequence && passthrough_output(filename);
+    if (need_passthrough && !passthrough) {
+        //source was modified or is going to be overwritten
+        WARN("Sequences were not loaded and segments can't be copied from "
+                     << (lines_ ? lines_->filename : "the input") << ", not writing " << filename);
+        return false;
+    }
+    FILE *f = io::OpenOutputFile(filename, compress, thread_cnt);
+    if (!f) {
+        WARN("Failed to open " << filename << " for writing");
+        return false;
+    }
+    fprintf(f, "H\tVN:Z:1.0\n");
+    bool ok = true;
+    if (passthrough && !io::WritePassthrough(get(), *lines_, f)) {
+        if (need_passthrough) {
+            WARN("Failed to copy segments from " << lines_->filename);
+            ok = false;
+        } else {
+            WARN("Failed to copy segments from " << lines_->filename << ", writing them from memory");
+            RawSequences raw(g_ptr_.get(), packed_.get(), true);
+            gfa_print(get(), f, 0);
+        }
+    } else if (!passthrough) {
+        RawSequences raw(g_ptr_.get(), packed_.get(), !drop_sequence);
+        gfa_print(get(), f, drop_sequence ? GFA_O_NO_SEQ : 0);
+    }
+    if (fclose(f) != 0) {
+        WARN("Failed to write graph to " << filename);
+        ok = false;
+    }
+    //not leaving truncated output behind
+    if (!ok)
+        remove(filename.c_str());
+    return ok;
+}
+
+//Deletions keep the arcs symmetric, so gfa_fix_symm_del (searching for the dual of every arc)
+//is only needed if some arcs had no dual to begin with
 void Graph::Cleanup() {
-    gfa_cleanup(get());
-    gfa_fix_symm_del(get());
+    if (!cleanup_needed_)
+        return;
+    cleanup_needed_ = false;
+    if (unpaired_arcs_) {
+        gfa_fix_symm_del(get());
+        unpaired_arcs_ = false;
+    } else {
+        gfa_cleanup(get());
+    }
+    //arcs were reordered
+    dual_arcs_.clear();
+    CountLiveDegrees();
+}
+
+//Arcs of the deleted segments don't need to be marked, gfa_arc_rm drops them anyway
+void Graph::Apply(const DeletionBatch &batch) {
+    assert(&batch.g_ == this);
+    gfa_t *g = get();
+    for (SegmentId s = 0; s < g->n_seg; ++s)
+        if (batch.segments_.count(s))
+            g->seg[s].del = 1;
+    if (!batch.arcs_.empty()) {
+        //single pass over the arcs instead of searching for each dual through the arcs of its end
+        if (dual_arcs_.empty())
+            IndexDualArcs();
+        for (uint64_t k = 0; k < g->n_arc; ++k) {
+            if (batch.arcs_.count(k)) {
+                g->arc[k].del = 1;
+                g->arc[dual_arcs_[k]].del = 1;
+            }
+        }
+    }
+    cleanup_needed_ = true;
+    Cleanup();
+}
+
+LinkList Graph::canonical_links() const {
+    const gfa_t *g = get();
+    std::vector<uint64_t> arc_ids;
+    for (uint64_t k = 0; k < g->n_arc; ++k)
+        if (!g->arc[k].del && IsCanonical(LinkInfo::FromInnerArcT(g->arc[k])))
+            arc_ids.push_back(k);
+    return LinkList(g->arc, std::move(arc_ids));
 }
 
 bool Graph::CheckNoDeadLinks() const {
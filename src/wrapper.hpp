@@ -1,12 +1,17 @@
 #pragma once
 
 #include "gfa.h"
+#include "gfa_io.hpp"
+#include "locality.hpp"
+#include "snapshot.hpp"
 #include "utils.hpp"
 
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <algorithm>
 
@@ -31,7 +36,11 @@ inline bool operator<(Direction a, Direction b) {
     return static_cast<int>(a) < static_cast<int>(b);
 }
 
+//Segment ids, inner vertex ids (2 * segment id + direction) and segment lengths,
+//same width as the ids and lengths stored by gfatools
 typedef uint32_t SegmentId;
+typedef uint32_t InnerVertexId;
+typedef uint32_t SegmentLength;
 
 struct DirectedSegment {
     SegmentId segment_id;
@@ -39,7 +48,7 @@ struct DirectedSegment {
 
     DirectedSegment(SegmentId segment_id_, Direction direction_) : segment_id(segment_id_), direction(direction_) { }
 
-    DirectedSegment() : segment_id(-1u), direction(Direction::FORWARD) { }
+    DirectedSegment() : segment_id(std::numeric_limits<SegmentId>::max()), direction(Direction::FORWARD) { }
 
     //DirectedSegment& operator=(const DirectedSegment &ds) {segment_id = ds.segment_id;direction = ds.direction; return *this;}// = default;
 
@@ -51,13 +60,13 @@ struct DirectedSegment {
         return DirectedSegment(seg_id, Direction::REVERSE);
     }
 
-    static DirectedSegment FromInnerVertexT(uint32_t v) {
+    static DirectedSegment FromInnerVertexT(InnerVertexId v) {
         return DirectedSegment(v >> 1, (v & 1) == 0 ? Direction::FORWARD : Direction::REVERSE);
     }
 
-    uint32_t AsInnerVertexT() const {
+    InnerVertexId AsInnerVertexT() const {
         //TODO simplify?
-        return segment_id << 1 | (direction == Direction::FORWARD ? 0 : 1);
+        return InnerVertexId(segment_id) << 1 | (direction == Direction::FORWARD ? 0 : 1);
     }
 
     DirectedSegment Complement() const {
@@ -77,13 +86,17 @@ struct DirectedSegment {
     }
 };
 
+//Dense containers in utils are indexed by inner vertex ids (capacity 2 * segment count)
+inline size_t DenseIndex(DirectedSegment v) {
+    return size_t(v.AsInnerVertexT());
+}
+
 //FIXME consider making a wrapper over original type rather than copying fields
 //FIXME it's hard to use without segment id
 struct SegmentInfo {
     //std::string sequence;
     const char* sequence;
-    //FIXME what about long segments?
-    const uint32_t length;
+    const SegmentLength length;
     const char* name;
     //bool removed;
 
@@ -112,81 +125,36 @@ private:
         //removed(s.del) {}
 };
 
-//TODO upgrade iterators
-class SegmentIterator {
-    gfa_seg_t *seg_ptr_;
+//Segment at position p is the one with id p
+class SegmentIterator: public utils::PositionIterator<SegmentIterator, SegmentInfo> {
+    gfa_seg_t *segs_;
 
 public:
-    explicit SegmentIterator(gfa_seg_t *seg_ptr) :
-        seg_ptr_(seg_ptr) {}
-
-    SegmentIterator& operator++() {
-        ++seg_ptr_;
-        return *this;
-    }
-
-    SegmentIterator operator++(int) {
-        auto retval = *this;
-        ++(*this);
-        return retval;
-    }
-
-    bool operator==(const SegmentIterator &other) const {
-        return seg_ptr_ == other.seg_ptr_;
-    }
+    explicit SegmentIterator(gfa_seg_t *segs = nullptr, size_t pos = 0) :
+        PositionIterator(ptrdiff_t(pos)), segs_(segs) {}
 
-    bool operator!=(const SegmentIterator &other) const {
-        return !(*this == other);
-    }
-
-    SegmentInfo operator*() const {
-        return SegmentInfo::FromInnerSegT(*seg_ptr_);
+    SegmentInfo at(ptrdiff_t pos) const {
+        return SegmentInfo::FromInnerSegT(segs_[pos]);
     }
-
-    // iterator traits
-    using difference_type = ptrdiff_t;
-    using value_type = SegmentInfo;
-    using pointer = const SegmentInfo*;
-    using reference = const SegmentInfo&;
-    using iterator_category = std::forward_iterator_tag;
 };
 
-class DirectedSegmentIterator {
-    uint32_t inner_v_;
+//Position p yields inner vertex p, or the forward orientation of segment p if forward_only is set.
+//If order is provided, segment s is replaced by order[s]
+class DirectedSegmentIterator: public utils::PositionIterator<DirectedSegmentIterator, DirectedSegment> {
+    const SegmentId *order_;
+    bool forward_only_;
 
 public:
-    explicit DirectedSegmentIterator(uint32_t inner_v) :
-        inner_v_(inner_v) {}
-
-    DirectedSegmentIterator& operator++() {
-        ++inner_v_;
-        return *this;
-    }
-
-    DirectedSegmentIterator operator++(int) {
-        auto retval = *this;
-        ++inner_v_;
-        return retval;
-    }
-
-    bool operator==(DirectedSegmentIterator other) const {
-        return inner_v_ == other.inner_v_;
-    }
+    explicit DirectedSegmentIterator(InnerVertexId pos = 0, const SegmentId *order = nullptr,
+                                     bool forward_only = false) :
+        PositionIterator(ptrdiff_t(pos)), order_(order), forward_only_(forward_only) {}
 
-    bool operator!=(DirectedSegmentIterator other) const {
-        return !(*this == other);
-    }
-
-    DirectedSegment operator*() const {
-        return DirectedSegment::FromInnerVertexT(inner_v_);
+    DirectedSegment at(ptrdiff_t pos) const {
+        const InnerVertexId inner_v = forward_only_ ? InnerVertexId(pos) << 1 : InnerVertexId(pos);
+        if (order_)
+            return DirectedSegment::FromInnerVertexT(InnerVertexId(order_[inner_v >> 1]) << 1 | (inner_v & 1));
+        return DirectedSegment::FromInnerVertexT(inner_v);
     }
-
-    // iterator traits
-    using difference_type = ptrdiff_t;
-    using value_type = DirectedSegment;
-    using pointer = const DirectedSegment*;
-    using reference = const DirectedSegment&;
-    using iterator_category = std::forward_iterator_tag;
 };
 
 //FIXME rename Links into Arcs or Edges, because they are directed?!
@@ -196,13 +164,21 @@ struct LinkInfo {
     int32_t start_overlap;
     int32_t end_overlap;
 
+    static constexpr uint64_t NO_ARC = uint64_t(-1);
+
     LinkInfo():
-        start_overlap(0), end_overlap(0) {}
+        start_overlap(0), end_overlap(0), arc_id_(NO_ARC) {}
         //id_(-1ull), complement_(false) {}
     //removed(false),
 
-    static LinkInfo FromInnerArcT(const gfa_arc_t &a) {
-        return LinkInfo(a);
+    static LinkInfo FromInnerArcT(const gfa_arc_t &a, uint64_t arc_id = NO_ARC) {
+        return LinkInfo(a, arc_id);
+    }
+
+    //Index of the underlying arc (or of its dual if link was complemented) in gfa_t::arc,
+    //NO_ARC if unknown. Enables constant time deletion, invalidated by Graph::Cleanup
+    uint64_t arc_id() const {
+        return arc_id_;
     }
 
     //FIXME consider dropping start/end overlap checks -- running into issues with invalid overlaps
@@ -241,25 +217,39 @@ struct LinkInfo {
 private:
     //uint64_t id_; // link_id: a pair of dual arcs are supposed to have the same link_id
     //bool complement_;
+    //not taken into account by comparisons
+    uint64_t arc_id_;
 
-    explicit LinkInfo(const gfa_arc_t &a) :
+    LinkInfo(const gfa_arc_t &a, uint64_t arc_id) :
         start(DirectedSegment::FromInnerVertexT(a.v_lv >> 32)),
         end(DirectedSegment::FromInnerVertexT(a.w)),
-        start_overlap(a.ov), end_overlap(a.ow) {}
+        start_overlap(a.ov), end_overlap(a.ow), arc_id_(arc_id) {}
         //id_(a.link_id), complement_(a.comp) {}
     //removed(a.del),
 };
 
+//Skips deleted arcs
 class LinkIterator {
-    gfa_arc_t *arc_ptr_;
+    const gfa_arc_t *arc_ptr_;
+    const gfa_arc_t *end_;
+    //start of gfa_t::arc, arc indices are reported relative to it
+    const gfa_arc_t *arcs_;
     bool complement_;
 
+    void SkipDeleted() {
+        while (arc_ptr_ != end_ && arc_ptr_->del)
+            ++arc_ptr_;
+    }
+
 public:
-    explicit LinkIterator(gfa_arc_t *arc_ptr, bool complement = false) :
-        arc_ptr_(arc_ptr), complement_(complement) {}
+    LinkIterator(const gfa_arc_t *arc_ptr, const gfa_arc_t *end, const gfa_arc_t *arcs, bool complement = false) :
+        arc_ptr_(arc_ptr), end_(end), arcs_(arcs), complement_(complement) {
+        SkipDeleted();
+    }
 
     LinkIterator& operator++() {
         ++arc_ptr_;
+        SkipDeleted();
         return *this;
     }
 
@@ -278,7 +268,8 @@ public:
     }
 
     LinkInfo operator*() const {
-        return complement_ ? LinkInfo::FromInnerArcT(*arc_ptr_).Complement() : LinkInfo::FromInnerArcT(*arc_ptr_);
+        auto l = LinkInfo::FromInnerArcT(*arc_ptr_, uint64_t(arc_ptr_ - arcs_));
+        return complement_ ? l.Complement() : l;
     }
 
     // iterator traits
@@ -289,8 +280,53 @@ public:
     using iterator_category = std::forward_iterator_tag;
 };
 
+//Position p yields the link of arc arc_ids[p]
+class ArcListIterator: public utils::PositionIterator<ArcListIterator, LinkInfo> {
+    const gfa_arc_t *arcs_;
+    const uint64_t *arc_ids_;
+
+public:
+    explicit ArcListIterator(const gfa_arc_t *arcs = nullptr, const uint64_t *arc_ids = nullptr, size_t pos = 0) :
+        PositionIterator(ptrdiff_t(pos)), arcs_(arcs), arc_ids_(arc_ids) {}
+
+    LinkInfo at(ptrdiff_t pos) const {
+        return LinkInfo::FromInnerArcT(arcs_[arc_ids_[pos]], arc_ids_[pos]);
+    }
+};
+
+//Random-access range over the links of the selected arcs (see Graph::canonical_links),
+//invalidated together with LinkInfo::arc_id
+class LinkList {
+    const gfa_arc_t *arcs_;
+    std::vector<uint64_t> arc_ids_;
+
+public:
+    LinkList(const gfa_arc_t *arcs, std::vector<uint64_t> arc_ids) :
+        arcs_(arcs), arc_ids_(std::move(arc_ids)) {}
+
+    ArcListIterator begin() const {
+        return ArcListIterator(arcs_, arc_ids_.data());
+    }
+
+    ArcListIterator end() const {
+        return ArcListIterator(arcs_, arc_ids_.data(), arc_ids_.size());
+    }
+
+    size_t size() const {
+        return arc_ids_.size();
+    }
+
+    LinkInfo operator[](size_t i) const {
+        return begin()[i];
+    }
+};
+
 class Graph;
 
+class DeletionBatch;
+
+class GraphBuilder;
+
 struct Path {
     std::vector<DirectedSegment> segments;
     std::vector<LinkInfo> links;
@@ -367,13 +403,68 @@ struct Path {
 };
 
 class Graph {
+    friend class GraphBuilder;
+
     std::unique_ptr<gfa_t, void(*)(gfa_t*)> g_ptr_;
+    //backing file of the graph loaded from snapshot
+    std::shared_ptr<io::MappedFile> mapping_;
+    //optional per-segment coverage (e.g. loaded from snapshot)
+    std::vector<double> coverage_;
+    //S-line locations in the source file, enable passthrough output
+    std::shared_ptr<io::SegmentLines> lines_;
+    //replaces gfa_seg_t::seq in PACKED sequence mode
+    std::unique_ptr<PackedSequences> packed_;
+    //graph was loaded in SKIP sequence mode, so sequences are only available from the source file
+    bool sequences_skipped_ = false;
+    //holds names, sequences and tags of segments loaded from GFA text (see set_arena_storage)
+    std::unique_ptr<utils::Arena> arena_;
+    bool arena_storage_ = true;
+    bool huge_pages_ = false;
+    //arc index -> index of its dual arc, built on first deletion, reset by Cleanup
+    std::vector<uint64_t> dual_arcs_;
+    //index found arcs without a dual (asymmetric input), Cleanup has to drop them
+    bool unpaired_arcs_ = false;
+    //some arcs or segments were marked as deleted since the last Cleanup
+    bool cleanup_needed_ = false;
+    //number of non-deleted outgoing arcs, indexed by inner vertex id
+    std::vector<uint32_t> live_degree_;
+    //position in the input -> current segment id and back, empty unless segments were reordered
+    std::vector<SegmentId> input_order_;
+    std::vector<SegmentId> input_pos_;
+
+    //Moves segment order[i] to id i together with its arcs and per-segment data
+    void Renumber(const std::vector<SegmentId> &order);
+
+    void IndexDualArcs();
+
+    //arc d goes between the complements of the ends of arc k in the opposite direction with swapped overlaps
+    bool IsDualArc(uint64_t k, uint64_t d) const;
+
+    void CountLiveDegrees();
+
+    //Marks arc with index k and its dual as deleted, keeping degrees up to date
+    void DeleteArc(uint64_t k);
+
+    //detaches data owned by the mapping or the arena before destroying the current graph
+    void Reset(gfa_t *g = nullptr, std::shared_ptr<io::MappedFile> mapping = nullptr,
+               std::unique_ptr<utils::Arena> arena = nullptr);
+
+    //memory not to be freed with the graph
+    bool borrowed(const void *p) const {
+        return (mapping_ && mapping_->contains(p)) || (arena_ && arena_->contains(p));
+    }
 
 public:
     Graph(): g_ptr_(nullptr, gfa_destroy) {}
 
-    Graph(const std::string &filename)
-        : g_ptr_(gfa_read(filename.c_str()), gfa_destroy) {}
+    Graph(const std::string &filename): Graph() {
+        open(filename);
+    }
+
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
+
+    ~Graph() { Reset(); }
 
     const gfa_t *get() const { return g_ptr_.get(); }
 
@@ -387,41 +478,136 @@ public:
     }
 
     //FIXME rename to 'read'
-    bool open(const std::string &filename) {
-        g_ptr_.reset(gfa_read(filename.c_str()));
-        return (bool)g_ptr_;
+    //Binary snapshots are detected automatically
+    //thread_cnt > 1 enables multithreaded parsing of uncompressed GFA
+    //In SKIP sequence mode only names, lengths and links are kept (sequences are reported as absent)
+    //Non-empty coverage_tag provides segment coverage from S-line tags (see io::TagCoverage)
+    bool open(const std::string &filename, unsigned thread_cnt = 1, SequenceMode mode = SequenceMode::RAW,
+              const std::string &coverage_tag = "");
+
+    //Renumbers segments to keep linked ones close in memory (see LocalityOrder).
+    //directed_segments() and write() keep following the input order, so tool results and output are unaffected.
+    //Invalidates segment ids, LinkInfo::arc_id and CsrGraph snapshots
+    void Reorder(SegmentOrder method);
+
+    bool reordered() const { return !input_order_.empty(); }
+
+    //Position of the segment in the input, same as its id unless the graph was reordered
+    SegmentId input_position(SegmentId segment_id) const {
+        return reordered() ? input_pos_[segment_id] : segment_id;
+    }
+
+    //Same as LinkInfo::IsCanonical, but not affected by reordering
+    bool IsCanonical(const LinkInfo &l) const {
+        if (!reordered())
+            return l.IsCanonical();
+        LinkInfo input_l = l;
+        input_l.start.segment_id = input_position(l.start.segment_id);
+        input_l.end.segment_id = input_position(l.end.segment_id);
+        return input_l.IsCanonical();
+    }
+
+    //Names, sequences and tags of segments loaded from GFA text are placed into large slabs
+    //(optionally backed by transparent huge pages) instead of individual allocations,
+    //which saves allocator overhead and makes the graph teardown cheap. Enabled by default (huge pages are not),
+    //affects next open
+    void set_arena_storage(bool enabled, bool huge_pages = false) {
+        arena_storage_ = enabled;
+        huge_pages_ = huge_pages;
+    }
+
+    //Moves sequences into 2-bit packed store, SegmentInfo::sequence becomes null,
+    //sequences are available through AppendSequence
+    void PackSequences();
+
+    bool has_sequence(SegmentId segment_id) const {
+        return (packed_ && packed_->has_sequence(segment_id)) || get()->seg[segment_id].seq;
     }
 
-    void write(const std::string &filename, bool drop_sequence = false) const {
-        //FIXME consider putting Cleanup call here
-        FILE *f = fopen(filename.c_str(), "w");
-        fprintf(f, "H\tVN:Z:1.0\n");
-        gfa_print(get(), f, drop_sequence ? GFA_O_NO_SEQ : 0);
-        fclose(f);
+    //Appends segment sequence (reverse-complemented for REVERSE direction) without the first trim bases
+    //Does nothing if segment has no sequence
+    void AppendSequence(DirectedSegment v, size_t trim, std::string &out) const;
+
+    //Writes binary snapshot if filename ends with .gfab
+    //compress enables BGZF-compressed GFA output using thread_cnt threads
+    //If graph was loaded from uncompressed GFA, S-lines are copied from it as is.
+    //Returns false if the output can't be written, or if sequences were skipped on loading
+    //and S-lines can't be copied (output is never silently stripped of sequences).
+    //Reordered graph is temporarily renumbered back to the input order
+    bool write(const std::string &filename, bool drop_sequence = false,
+               bool compress = false, unsigned thread_cnt = 1);
+
+    //S-lines can be copied from the source file when writing to filename
+    bool passthrough_output(const std::string &filename) const {
+        return lines_ && lines_->Usable(get(), filename);
     }
 
     bool valid() const { return bool(g_ptr_); }
 
-    void DeleteSegment(SegmentId segment_id) { gfa_seg_del(get(), segment_id); }
+    //per-segment coverage, empty if not available
+    const std::vector<double> &coverage() const { return coverage_; }
+
+    bool has_coverage() const { return !coverage_.empty(); }
+
+    double coverage(SegmentId segment_id) const {
+        assert(segment_id < coverage_.size() && !std::isnan(coverage_[segment_id]));
+        return coverage_[segment_id];
+    }
+
+    double coverage(DirectedSegment v) const { return coverage(v.segment_id); }
+
+    //Reads '<segment name> <coverage>' table (see io::ReadSegmentValues)
+    bool LoadCoverage(const std::string &filename, unsigned thread_cnt = 1);
+
+    void set_coverage(std::vector<double> coverage) {
+        assert(coverage.empty() || coverage.size() == segment_cnt());
+        coverage_ = std::move(coverage);
+    }
+
+    //Marks segment and all its links as deleted (same as gfa_seg_del)
+    void DeleteSegment(SegmentId segment_id);
 
-    void DeleteSegment(DirectedSegment v) { gfa_seg_del(get(), v.segment_id); }
+    void DeleteSegment(DirectedSegment v) { DeleteSegment(v.segment_id); }
 
+    //Physically removes deleted links, invalidates LinkInfo::arc_id.
+    //Not needed for the link counts and iterators to reflect the deletions
     void Cleanup();
 
+    //Deletes all segments and links of the batch (together with the duals of the links)
+    //and removes them with a single pass over the arcs, same as the deletions followed by Cleanup
+    void Apply(const DeletionBatch &batch);
+
     bool CheckNoDeadLinks() const;
 
-    //FIXME make faster by including a pointer to an arc into LinkInfo instead of copying
-    void DeleteLink(LinkInfo l) {
-        DeleteLink(l.start, l.end);
+    //Marks the arc of the link and its dual without searching if the link came from
+    //one of the graph iterators (see LinkInfo::arc_id), otherwise falls back to the search by ends
+    void DeleteLink(const LinkInfo &l) {
+        if (l.arc_id() == LinkInfo::NO_ARC) {
+            DeleteLink(l.start, l.end);
+            return;
+        }
+        assert(l.arc_id() < link_cnt());
+        const gfa_arc_t &a = get()->arc[l.arc_id()];
+        (void) a;
+        assert((l.start.AsInnerVertexT() == (a.v_lv >> 32) && l.end.AsInnerVertexT() == a.w) ||
+               (l.end.AsInnerVertexT() == ((a.v_lv >> 32) ^ 1) && l.start.AsInnerVertexT() == (a.w ^ 1)));
+        DeleteArc(l.arc_id());
     }
 
-    void DeleteLink(DirectedSegment v, DirectedSegment w) {
-        //FIXME consider making the second call to simplify checks of alive arcs
-        gfa_arc_del(get(), v.AsInnerVertexT(), w.AsInnerVertexT(), 1);
-    }
+    //Marks all arcs from v to w and their duals, searches through outgoing arcs of v
+    void DeleteLink(DirectedSegment v, DirectedSegment w);
+
+    //Index of the dual of every arc in gfa_t::arc (the arc itself if there is none), without per-arc searches.
+    //Invalidated by Cleanup
+    std::vector<uint64_t> DualArcIndex() const;
+
+    //Index of the dual of arc k in gfa_t::arc (k itself if there is none),
+    //searches through the arcs of its end unless the dual arc index was built by a deletion
+    uint64_t FindDualArc(uint64_t k) const;
 
+    //Deleted links are not counted
     uint32_t outgoing_link_cnt(DirectedSegment v) const {
-        return gfa_arc_n(get(), v.AsInnerVertexT());
+        return live_degree_[v.AsInnerVertexT()];
     }
 
     bool unique_outgoing(DirectedSegment v) const {
@@ -433,11 +619,13 @@ public:
     }
 
     LinkIterator outgoing_begin(DirectedSegment v) const {
-        return LinkIterator(gfa_arc_a(get(), v.AsInnerVertexT()));
+        const gfa_arc_t *a = gfa_arc_a(get(), v.AsInnerVertexT());
+        return LinkIterator(a, a + gfa_arc_n(get(), v.AsInnerVertexT()), get()->arc);
     }
 
     LinkIterator outgoing_end(DirectedSegment v) const {
-        return LinkIterator(gfa_arc_a(get(), v.AsInnerVertexT()) + gfa_arc_n(get(), v.AsInnerVertexT()));
+        const gfa_arc_t *e = gfa_arc_a(get(), v.AsInnerVertexT()) + gfa_arc_n(get(), v.AsInnerVertexT());
+        return LinkIterator(e, e, get()->arc);
     }
 
     utils::ProxyContainer<LinkIterator> outgoing_links(DirectedSegment v) const {
@@ -445,7 +633,7 @@ public:
     }
 
     uint32_t incoming_link_cnt(DirectedSegment v) const {
-        return gfa_arc_n(get(), v.Complement().AsInnerVertexT());
+        return live_degree_[v.Complement().AsInnerVertexT()];
     }
 
     bool unique_incoming(DirectedSegment v) const {
@@ -457,12 +645,15 @@ public:
     }
 
     LinkIterator incoming_begin(DirectedSegment v) const {
-        return LinkIterator(gfa_arc_a(get(), v.Complement().AsInnerVertexT()), /*complement*/true);
+        auto inner_v = v.Complement().AsInnerVertexT();
+        const gfa_arc_t *a = gfa_arc_a(get(), inner_v);
+        return LinkIterator(a, a + gfa_arc_n(get(), inner_v), get()->arc, /*complement*/true);
     }
 
     LinkIterator incoming_end(DirectedSegment v) const {
         auto inner_v = v.Complement().AsInnerVertexT();
-        return LinkIterator(gfa_arc_a(get(), inner_v) + gfa_arc_n(get(), inner_v), /*complement*/true);
+        const gfa_arc_t *e = gfa_arc_a(get(), inner_v) + gfa_arc_n(get(), inner_v);
+        return LinkIterator(e, e, get()->arc, /*complement*/true);
     }
 
     utils::ProxyContainer<LinkIterator> incoming_links(DirectedSegment v) const {
@@ -478,12 +669,13 @@ public:
         return segment(v.segment_id);
     }
 
-    std::string segment_name(SegmentId segment_id) const {
+    //Points to the name stored in the graph
+    std::string_view segment_name(SegmentId segment_id) const {
         assert(segment_id < segment_cnt());
         return get()->seg[segment_id].name;
     }
 
-    std::string segment_name(DirectedSegment v) const {
+    std::string_view segment_name(DirectedSegment v) const {
         return segment_name(v.segment_id);
     }
 
@@ -496,51 +688,90 @@ public:
         return segment_length(v.segment_id);
     }
 
+    //Segments are listed in id order
     SegmentIterator segment_begin() const {
         return SegmentIterator(get()->seg);
     }
 
     SegmentIterator segment_end() const {
-        return SegmentIterator(get()->seg + segment_cnt());
+        return SegmentIterator(get()->seg, segment_cnt());
     }
 
     utils::ProxyContainer<SegmentIterator> segments() const {
         return utils::ProxyContainer<SegmentIterator>(segment_begin(), segment_end());
     }
 
+    //Directed segments are listed in the input order (even if the graph was reordered)
     DirectedSegmentIterator directed_segment_begin() const {
-        return DirectedSegmentIterator(0);
+        return DirectedSegmentIterator(0, reordered() ? input_order_.data() : nullptr);
     }
 
     DirectedSegmentIterator directed_segment_end() const {
-        return DirectedSegmentIterator(gfa_n_vtx(get()));
+        return DirectedSegmentIterator(gfa_n_vtx(get()), reordered() ? input_order_.data() : nullptr);
     }
 
     utils::ProxyContainer<DirectedSegmentIterator> directed_segments() const {
         return utils::ProxyContainer<DirectedSegmentIterator>(directed_segment_begin(), directed_segment_end());
     }
 
-    std::string str(SegmentId segment_id) const {
-        return std::string(segment(segment_id).name);
+    //Forward orientations of all segments in the input order
+    utils::ProxyContainer<DirectedSegmentIterator> forward_segments() const {
+        const SegmentId *order = reordered() ? input_order_.data() : nullptr;
+        return utils::ProxyContainer<DirectedSegmentIterator>(DirectedSegmentIterator(0, order, /*forward only*/true),
+                                                              DirectedSegmentIterator(segment_cnt(), order, /*forward only*/true));
     }
 
-    std::string str(DirectedSegment v, const std::string &delim = "") const {
-        return std::string(segment(v.segment_id).name) + delim + PrintDirection(v.direction);
+    //Non-deleted links satisfying IsCanonical (one per pair of dual arcs) in the order of their arcs.
+    //Takes a pass over the arcs, the list is invalidated together with LinkInfo::arc_id
+    LinkList canonical_links() const;
+
+    //Append* counterparts of str(...) format into a caller-owned buffer
+    void AppendStr(std::string &out, SegmentId segment_id) const {
+        out.append(segment_name(segment_id));
     }
 
-    std::string str(const LinkInfo &l, const std::string &d = "->") const {
-        return str(l.start) + d + str(l.end);
-        // + " (s_o: " + std::to_string(l.start_overlap) + ", e_o:" + std::to_string(l.end_overlap) + ")";
+    void AppendStr(std::string &out, DirectedSegment v, std::string_view delim = "") const {
+        out.append(segment_name(v));
+        out.append(delim);
+        out.push_back(PrintDirection(v.direction));
     }
 
-    std::string str(const Path &p, const std::string &d = " -> ") const {
-        std::stringstream ss;
-        std::string delim;
+    void AppendStr(std::string &out, const LinkInfo &l, std::string_view d = "->") const {
+        AppendStr(out, l.start);
+        out.append(d);
+        AppendStr(out, l.end);
+    }
+
+    void AppendStr(std::string &out, const Path &p, std::string_view d = " -> ") const {
+        std::string_view delim;
         for (const auto &v : p.segments) {
-            ss << delim << str(v);
+            out.append(delim);
+            AppendStr(out, v);
             delim = d;
         }
-        return ss.str();
+    }
+
+    std::string str(SegmentId segment_id) const {
+        return std::string(segment_name(segment_id));
+    }
+
+    std::string str(DirectedSegment v, std::string_view delim = "") const {
+        std::string answer;
+        AppendStr(answer, v, delim);
+        return answer;
+    }
+
+    std::string str(const LinkInfo &l, std::string_view d = "->") const {
+        std::string answer;
+        AppendStr(answer, l, d);
+        return answer;
+        // + " (s_o: " + std::to_string(l.start_overlap) + ", e_o:" + std::to_string(l.end_overlap) + ")";
+    }
+
+    std::string str(const Path &p, std::string_view d = " -> ") const {
+        std::string answer;
+        AppendStr(answer, p, d);
+        return answer;
     }
 
     size_t total_length(const Path &p) const {
@@ -555,4 +786,53 @@ public:
 
 };
 
+//Segment and link deletions collected with set bits instead of arc flags and degree updates,
+//applied at once with Graph::Apply. The graph is not changed until then,
+//so marks made in a single pass over the graph don't affect each other.
+//Invalidated by modifications of the graph other than the deletions
+class DeletionBatch {
+    friend class Graph;
+
+    const Graph &g_;
+    utils::DenseSet<SegmentId> segments_;
+    //indices in gfa_t::arc, the duals are added on Graph::Apply
+    utils::DenseSet<uint64_t> arcs_;
+
+public:
+    explicit DeletionBatch(const Graph &g):
+        g_(g), segments_(g.segment_cnt()), arcs_(g.link_cnt()) {}
+
+    void DeleteSegment(SegmentId segment_id) {
+        segments_.insert(segment_id);
+    }
+
+    void DeleteSegment(DirectedSegment v) { DeleteSegment(v.segment_id); }
+
+    //Constant time if the link came from one of the graph iterators (see LinkInfo::arc_id)
+    void DeleteLink(const LinkInfo &l) {
+        if (l.arc_id() == LinkInfo::NO_ARC) {
+            DeleteLink(l.start, l.end);
+            return;
+        }
+        assert(l.arc_id() < g_.link_cnt());
+        arcs_.insert(l.arc_id());
+    }
+
+    //Marks all arcs from v to w, searches through outgoing arcs of v
+    void DeleteLink(DirectedSegment v, DirectedSegment w) {
+        const gfa_t *g = g_.get();
+        const uint64_t start = gfa_arc_a(g, v.AsInnerVertexT()) - g->arc;
+        for (uint64_t k = start; k < start + gfa_arc_n(g, v.AsInnerVertexT()); ++k)
+            if (g->arc[k].w == w.AsInnerVertexT())
+                arcs_.insert(k);
+    }
+
+    size_t segment_cnt() const { return segments_.size(); }
+
+    //dual arcs of the marked ones are not counted
+    size_t arc_cnt() const { return arcs_.size(); }
+
+    bool empty() const { return segments_.empty() && arcs_.empty(); }
+};
+
 }